@@ -40,8 +40,13 @@ application::DirectorySignal::DirectorySignal(std::shared_ptr<std::vector<copyto
                 continue;
             }
 
-            DS_resources* monitor = new DS_resources{hDir, {}, {}, {{dir.source},{dir.destination},{dir.commands},{dir.co}}};
-            
+            DS_resources* monitor = new DS_resources(hDir,dir);
+            monitor->m_job = m_queue_processor.add_job(dir);
+
+            // -sync mirrors src, the queue system reconciles the tree with its sync index when it starts
+            if((dir.commands & cs::sync) != cs::none){
+                m_queue_processor.use_index(monitor->m_job);
+            }
             
             if(!CreateIoCompletionPort(hDir, m_hCompletionPort, (ULONG_PTR)monitor, 0)){
                 logger log(Error::WARNING);
@@ -98,10 +103,7 @@ void application::DirectorySignal::monitor() noexcept{
     DS_resources* pMonitor;
     LPOVERLAPPED pOverlapped;
     
-    timer t;
-    std::atomic<bool> start_timer{false};
-    std::condition_variable timer_thread_notify_cv;
-    std::jthread timer_thread(&timer::notify_timer,&t,30.0,&m_queue_processor.m_ready_to_process,&m_queue_processor.m_local_thread_cv,&start_timer,&timer_thread_notify_cv);
+    // every path waits for its own quiet period in the queue system, there is no global timer
 
     while (GetQueuedCompletionStatus(m_hCompletionPort, &bytesTransferred, (PULONG_PTR)&pMonitor, &pOverlapped, INFINITE)) {
         Overflow(bytesTransferred);
@@ -112,22 +114,12 @@ void application::DirectorySignal::monitor() noexcept{
         ProcessDirectoryChanges(pNotify,pMonitor);
 
         UpdateWatcher(pMonitor);
-
-        start_timer = true;
-        timer_thread_notify_cv.notify_one();
     }
 
 
 
-    t.end_notify_timer();
-    if(timer_thread.joinable()){
-        timer_thread_notify_cv.notify_one();
-        timer_thread.join();
-    }
-
     m_queue_processor.exit();
     if(q_sys_thread.joinable()){
-        m_queue_processor.m_local_thread_cv.notify_one();
         q_sys_thread.join();
     }
 }
@@ -187,31 +179,26 @@ void application::DirectorySignal::ProcessDirectoryChanges(FILE_NOTIFY_INFORMATI
         // Extract the file name included directories in the monitored tree
         std::wstring fileName(pNotify->FileName, pNotify->FileNameLength / sizeof(WCHAR));
         
-        // setup a file_queue_info structure
-        file_queue_info entry;
+        // setup a file_event structure, the paths and options of the monitored directory are in the job table
+        file_event entry;
 
         // fill the structure with data
-        entry.src = pMonitor->directory.source/fileName;
-        entry.dst = pMonitor->directory.destination/fileName;
-        auto gfs_src = sfct_api::get_file_status(entry.src);
-        auto gfs_dst = sfct_api::get_file_status(entry.dst);
+        entry.relative = fileName;
+        entry.job = pMonitor->m_job;
+        auto gfs_src = sfct_api::get_file_status(pMonitor->directory.source/fileName);
+        auto gfs_dst = sfct_api::get_file_status(pMonitor->directory.destination/fileName);
 
-        // if gfs_src or gfs_dst is std::nullopt then entry.fs_src and entry.fs_dst will be std::filesystem::file_type::none
+        // if gfs_src or gfs_dst is std::nullopt then entry.src_type and entry.dst_type will be std::filesystem::file_type::none
         // The none value is used for default-constructed file_status objects or when the file type has not been determined, 
         // whereas not_found indicates that a path does not exist or cannot be accessed.
 
         if(gfs_src.has_value()){
-            entry.fs_src = gfs_src.value();
+            entry.src_type = gfs_src.value().type();
         }
         
         if(gfs_dst.has_value()){
-            entry.fs_dst = gfs_dst.value();
+            entry.dst_type = gfs_dst.value().type();
         }
-        
-        entry.co = pMonitor->directory.co;
-        entry.commands = pMonitor->directory.commands;
-        entry.main_dst = pMonitor->directory.destination;
-        entry.main_src = pMonitor->directory.source;
 
         
         // Process the file change
@@ -244,8 +231,10 @@ void application::DirectorySignal::ProcessDirectoryChanges(FILE_NOTIFY_INFORMATI
                 break;
         }
 
-        // add the entry to queue system
-        m_queue_processor.add_to_queue(entry);
+        // add the entry to queue system, there is no rescan on windows so a dropped event is only reported
+        if(!m_queue_processor.add_to_queue(entry)){
+            STDOUT << App_MESSAGE("The monitor queue is full, events dropped: ") << m_queue_processor.dropped() << "\n";
+        }
 
         // check if there is no more data in pNotify
         if(pNotify->NextEntryOffset==0){
@@ -263,4 +252,555 @@ void application::DirectorySignal::ProcessDirectoryChanges(FILE_NOTIFY_INFORMATI
 /* Linux version of the directory signal class definitions */
 /////////////////////////////////////////////////////////////
 #if LINUX_BUILD
+
+application::DirectorySignal::DirectorySignal(std::shared_ptr<std::vector<copyto>> dirs_to_watch) noexcept
+:m_dirs(dirs_to_watch){
+
+    try{
+        if(!dirs_to_watch){
+            logger log(App_MESSAGE("nullptr"),Error::FATAL);
+            log.to_console();
+            log.to_log_file();
+            // create an object to safely exit the DirectorySignal class
+            m_dirs = std::make_shared<std::vector<copyto>>();
+        }
+
+        if(m_epoll_fd < 0){
+            logger log(std::error_code(errno,std::system_category()),Error::FATAL,std::filesystem::path());
+            log.to_console();
+            log.to_log_file();
+            no_watch = true;
+            return;
+        }
+        
+        if(m_dirs->empty()){
+            no_watch = true;
+        }
+
+        STDOUT << "\n";
+        for(const auto &dir:*m_dirs){
+            STDOUT << App_MESSAGE("Monitoring directory: ") << dir.source << App_MESSAGE(" to: ") << dir.destination << "\n";
+
+            int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if(fd < 0){
+                logger log(std::error_code(errno,std::system_category()),Error::WARNING,dir.source);
+                log.to_console();
+                log.to_log_file();
+                continue;
+            }
+
+            DS_resources* monitor = new DS_resources(fd,dir);
+            monitor->m_job = m_queue_processor.add_job(dir);
+
+            // -sync mirrors src, the queue system reconciles the tree with its sync index when it starts
+            if((dir.commands & cs::sync) != cs::none){
+                m_queue_processor.use_index(monitor->m_job);
+            }
+
+            AddWatchTree(monitor,dir.source,false);
+
+            // every watched tree is multiplexed on the same epoll instance
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = monitor;
+            if(epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0){
+                logger log(std::error_code(errno,std::system_category()),Error::WARNING,dir.source);
+                log.to_console();
+                log.to_log_file();
+            }
+
+            m_pMonitors.push_back(monitor);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+}
+
+application::DirectorySignal::~DirectorySignal(){
+    // Cleanup
+    for (auto monitor : m_pMonitors) {
+        if(monitor){
+            // closing the inotify instance removes all of its watches
+            close(monitor->m_fd);
+            delete monitor;
+        }
+    }
+
+    if(m_epoll_fd >= 0){
+        close(m_epoll_fd);
+    }
+}
+
+void application::DirectorySignal::monitor() noexcept{
+    // no monitor directories set so exit the monitor function
+    if(no_watch) return;
+
+    std::jthread q_sys_thread(&application::queue_system<file_queue_info>::process, &m_queue_processor);
+
+    // every path waits for its own quiet period in the queue system, there is no global timer
+
+    // Process notifications
+    epoll_event events[16];
+
+    while(true){
+        // a move that is waiting for its pair needs a wake up even if no other event comes
+        bool moves{false};
+        for(auto pMonitor:m_pMonitors){
+            moves = moves || !pMonitor->m_moved_from.empty();
+        }
+
+        int ready = epoll_wait(m_epoll_fd, events, 16, moves ? static_cast<int>(MonitorMovePairWait) : -1);
+        if(ready < 0){
+            // interrupted by a signal, wait again
+            if(errno == EINTR){
+                continue;
+            }
+
+            logger log(std::error_code(errno,std::system_category()),Error::WARNING,std::filesystem::path());
+            log.to_console();
+            log.to_log_file();
+            break;
+        }
+
+        for(int i{}; i < ready; i++){
+            DS_resources* pMonitor = static_cast<DS_resources*>(events[i].data.ptr);
+
+            // the inotify instance is non blocking, read until it is drained
+            ssize_t bytes_read;
+            while((bytes_read = read(pMonitor->m_fd, pMonitor->m_buffer, sizeof(pMonitor->m_buffer))) > 0){
+                ProcessDirectoryChanges(bytes_read,pMonitor);
+            }
+
+            // the queue system could not keep up and dropped events, the rescan can drop events too so repeat until it does not
+            while(pMonitor->m_rescan){
+                pMonitor->m_rescan = false;
+                STDOUT << App_MESSAGE("The monitor queue is full, events dropped: ") << m_queue_processor.dropped()
+                       << App_MESSAGE(" most events queued: ") << m_queue_processor.high_water() << "/" << m_queue_processor.capacity() << "\n";
+                Rescan(pMonitor);
+            }
+        }
+
+        for(auto pMonitor:m_pMonitors){
+            FlushMoves(pMonitor,false);
+        }
+    }
+
+
+
+    m_queue_processor.exit();
+    if(q_sys_thread.joinable()){
+        q_sys_thread.join();
+    }
+}
+
+bool application::DirectorySignal::Overflow(const inotify_event* pNotify) noexcept
+{
+    if(pNotify->mask & IN_Q_OVERFLOW){
+        STDOUT << App_MESSAGE("The monitoring buffer has overflowed") << "\n";
+        return true;
+    }
+    return false;
+}
+
+void application::DirectorySignal::AddWatchTree(DS_resources* p_monitor,const std::filesystem::path& dir,bool queue_entries) noexcept
+{
+    try{
+        auto add_watch = [this,p_monitor](const std::filesystem::path& watch_dir){
+            // adding a watch to a directory that is already watched returns the same descriptor
+            int wd = inotify_add_watch(p_monitor->m_fd, watch_dir.c_str(), m_NotifyFilter);
+            if(wd < 0){
+                logger log(std::error_code(errno,std::system_category()),Error::WARNING,watch_dir);
+                log.to_console();
+                log.to_log_file();
+                return;
+            }
+            p_monitor->m_watches[wd] = watch_dir;
+        };
+
+        add_watch(dir);
+
+        if(!sfct_api::recursive_flag_check(p_monitor->directory.commands)){
+            return;
+        }
+
+        for(const auto& entry:std::filesystem::recursive_directory_iterator(dir,std::filesystem::directory_options::skip_permission_denied)){
+            std::error_code e;
+            if(entry.is_directory(e) && !entry.is_symlink(e)){
+                add_watch(entry.path());
+            }
+
+            if(queue_entries){
+                file_event _file_info = MakeEvent(entry.path(),p_monitor);
+                _file_info.fqs = file_queue_status::file_added;
+                QueueEntry(p_monitor,_file_info);
+            }
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::DirectorySignal::Rescan(DS_resources* p_monitor) noexcept
+{
+    try{
+        const copyto& dir = p_monitor->directory;
+        STDOUT << App_MESSAGE("Rescanning directory: ") << dir.source << "\n";
+
+        // directories created while events were being dropped have no watch yet
+        AddWatchTree(p_monitor,dir.source,false);
+
+        // queue anything in src that is missing or newer than in dst
+        auto check_src = [this,p_monitor,&dir](const std::filesystem::directory_entry& entry){
+            file_event _file_info = MakeEvent(entry.path(),p_monitor);
+            if(_file_info.dst_type == std::filesystem::file_type::none){
+                _file_info.fqs = file_queue_status::file_added;
+                QueueEntry(p_monitor,_file_info);
+            }
+            else if(_file_info.src_type == std::filesystem::file_type::regular){
+                std::error_code e_src,e_dst;
+                auto t_src = std::filesystem::last_write_time(entry.path(),e_src);
+                auto t_dst = std::filesystem::last_write_time(dir.destination/_file_info.relative,e_dst);
+                if(!e_src && !e_dst && t_src > t_dst){
+                    _file_info.fqs = file_queue_status::file_updated;
+                    QueueEntry(p_monitor,_file_info);
+                }
+            }
+        };
+
+        if(sfct_api::recursive_flag_check(dir.commands)){
+            for(const auto& entry:std::filesystem::recursive_directory_iterator(dir.source,std::filesystem::directory_options::skip_permission_denied)){
+                check_src(entry);
+            }
+        }
+        else{
+            for(const auto& entry:std::filesystem::directory_iterator(dir.source,std::filesystem::directory_options::skip_permission_denied)){
+                check_src(entry);
+            }
+        }
+
+        // removals are only mirrored with -sync
+        if((dir.commands & cs::sync) == cs::none){
+            return;
+        }
+
+        for(auto entry = std::filesystem::recursive_directory_iterator(dir.destination,std::filesystem::directory_options::skip_permission_denied);
+            entry != std::filesystem::recursive_directory_iterator(); entry++){
+            std::filesystem::path src = dir.source/entry->path().lexically_relative(dir.destination);
+            if(!sfct_api::exists(src)){
+                file_event _file_info = MakeEvent(src,p_monitor);
+                _file_info.fqs = file_queue_status::file_removed;
+                QueueEntry(p_monitor,_file_info);
+
+                // removing a directory removes everything below it
+                entry.disable_recursion_pending();
+            }
+            else if(!sfct_api::recursive_flag_check(dir.commands)){
+                entry.disable_recursion_pending();
+            }
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+application::file_event application::DirectorySignal::MakeEvent(const std::filesystem::path& src,DS_resources* pMonitor) noexcept
+{
+    // setup a file_event structure, the paths and options of the monitored directory are in the job table
+    file_event entry;
+
+    try{
+        // fill the structure with data
+        std::filesystem::path relative = src.lexically_relative(pMonitor->directory.source);
+        auto gfs_src = sfct_api::get_file_status(src);
+        auto gfs_dst = sfct_api::get_file_status(pMonitor->directory.destination/relative);
+
+        // if gfs_src or gfs_dst is std::nullopt then entry.src_type and entry.dst_type will be std::filesystem::file_type::none
+        if(gfs_src.has_value()){
+            entry.src_type = gfs_src.value().type();
+        }
+        
+        if(gfs_dst.has_value()){
+            entry.dst_type = gfs_dst.value().type();
+        }
+
+        entry.relative = relative.native();
+        entry.job = pMonitor->m_job;
+        entry.fqs = file_queue_status::none;
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    return entry;
+}
+
+void application::DirectorySignal::QueueEntry(DS_resources* pMonitor,const file_event& entry) noexcept
+{
+    if(!m_queue_processor.add_to_queue(entry)){
+        pMonitor->m_rescan = true;
+    }
+}
+
+void application::DirectorySignal::FlushMoves(DS_resources* pMonitor,bool all) noexcept
+{
+    try{
+        auto now = std::chrono::steady_clock::now();
+        for(auto move = pMonitor->m_moved_from.begin(); move != pMonitor->m_moved_from.end();){
+            if(!all && now - move->second.seen < std::chrono::milliseconds(MonitorMovePairWait)){
+                move++;
+                continue;
+            }
+
+            MovedOut(pMonitor,move->second.src,move->second.is_dir);
+            move = pMonitor->m_moved_from.erase(move);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::DirectorySignal::MovedOut(DS_resources* pMonitor,const std::filesystem::path& old_src,bool is_dir) noexcept
+{
+    try{
+        // to the monitor it is the same as a removal
+        file_event entry = MakeEvent(old_src,pMonitor);
+        entry.fqs = (pMonitor->directory.commands & cs::sync) != cs::none ? file_queue_status::file_removed : file_queue_status::none;
+        QueueEntry(pMonitor,entry);
+
+        if(!is_dir){
+            return;
+        }
+
+        // the watches still hold paths inside the tree, a directory created there later with the same name
+        // would get the events of the one that moved out
+        for(auto w = pMonitor->m_watches.begin(); w != pMonitor->m_watches.end();){
+            auto relative = w->second.lexically_relative(old_src);
+            if(!relative.empty() && *relative.begin() != ".."){
+                inotify_rm_watch(pMonitor->m_fd,w->first);
+                w = pMonitor->m_watches.erase(w);
+            }
+            else{
+                w++;
+            }
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::DirectorySignal::ProcessDirectoryChanges(ssize_t bytes_read,DS_resources* pMonitor) noexcept
+{
+    try{
+        bool removals{(pMonitor->directory.commands & cs::sync) != cs::none};
+
+        // Process each notification
+        for(char* p = pMonitor->m_buffer; p < pMonitor->m_buffer + bytes_read;){
+            const inotify_event* pNotify = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + pNotify->len;
+
+            if(Overflow(pNotify)){
+                // the pairs of the waiting moves may be lost, the rescan picks up whatever they did
+                FlushMoves(pMonitor,true);
+
+                // events for this tree were dropped, only this tree needs to be rescanned
+                Rescan(pMonitor);
+                continue;
+            }
+
+            // the watched directory was removed or moved out of the tree
+            if(pNotify->mask & IN_IGNORED){
+                pMonitor->m_watches.erase(pNotify->wd);
+                continue;
+            }
+
+            auto watch = pMonitor->m_watches.find(pNotify->wd);
+            if(watch == pMonitor->m_watches.end() || pNotify->len == 0){
+                continue;
+            }
+
+            // Extract the file name included directories in the monitored tree
+            std::filesystem::path src = watch->second/pNotify->name;
+            bool is_dir = (pNotify->mask & IN_ISDIR) != 0;
+
+            // Process the file change
+            if(pNotify->mask & IN_MOVED_FROM){
+                pMonitor->m_moved_from[pNotify->cookie] = {src,is_dir,std::chrono::steady_clock::now()};
+                continue;
+            }
+
+            file_event entry = MakeEvent(src,pMonitor);
+
+            if(pNotify->mask & IN_MODIFY){
+                entry.fqs = file_queue_status::file_updated;
+            }
+            else if(pNotify->mask & IN_CLOSE_WRITE){
+                // the writer is done, the queue system copies it without waiting for the path to go quiet
+                entry.fqs = file_queue_status::file_closed;
+            }
+            else if(pNotify->mask & IN_CREATE){
+                entry.fqs = file_queue_status::file_added;
+            }
+            else if(pNotify->mask & IN_DELETE){
+                entry.fqs = removals ? file_queue_status::file_removed : file_queue_status::none;
+            }
+            else if(pNotify->mask & IN_MOVED_TO){
+                auto old = pMonitor->m_moved_from.find(pNotify->cookie);
+                if(old != pMonitor->m_moved_from.end()){
+                    const std::filesystem::path& old_src = old->second.src;
+
+                    // a rename inside the tree, send the pair the same way windows reports it
+                    file_event old_entry = MakeEvent(old_src,pMonitor);
+                    old_entry.fqs = file_queue_status::rename_old;
+                    QueueEntry(pMonitor,old_entry);
+                    entry.fqs = file_queue_status::rename_new;
+
+                    // watches below a renamed directory still hold the old path
+                    if(is_dir){
+                        for(auto& w:pMonitor->m_watches){
+                            auto relative = w.second.lexically_relative(old_src);
+                            if(!relative.empty() && *relative.begin() != ".."){
+                                w.second = relative == "." ? src : src/relative;
+                            }
+                        }
+                    }
+                    pMonitor->m_moved_from.erase(old);
+                }
+                else{
+                    // moved in from outside the tree
+                    entry.fqs = file_queue_status::file_added;
+                }
+            }
+
+            // add the entry to queue system
+            QueueEntry(pMonitor,entry);
+
+            // new directories need watches, anything written into them before the watch existed is queued too
+            if(is_dir && (pNotify->mask & (IN_CREATE | IN_MOVED_TO)) && entry.fqs == file_queue_status::file_added){
+                AddWatchTree(pMonitor,src,true);
+            }
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
 #endif
\ No newline at end of file
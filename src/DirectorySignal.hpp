@@ -18,8 +18,7 @@
 // This header is responsible for monitoring directories for changes
 //
 // Future TODO:                                                    
-// 1. Linux version of the class                                   
-// 2. MacOS version of the class                                                                                                  
+// 1. MacOS version of the class                                                                                                  
 /////////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////////////
@@ -29,10 +28,14 @@
 #include <Windows.h>
 namespace application{
     struct DS_resources {
-        HANDLE m_hDir;
+        DS_resources(HANDLE hDir,const copyto& dir) noexcept : m_hDir{hDir}, directory{dir} {}
+
+        HANDLE m_hDir{INVALID_HANDLE_VALUE};
         BYTE m_buffer[MonitorBuffer]; // 10MB buffer, do not allocate this on the stack, value defined in constants.hpp
-        OVERLAPPED m_ol;
+        OVERLAPPED m_ol{};
         copyto directory;
+        // index of directory in the queue system's job table
+        std::uint32_t m_job{};
     }; 
 
     class DirectorySignal{
@@ -70,9 +73,82 @@ namespace application{
 /* Linux version of directory signal class */
 /////////////////////////////////////////////
 #if LINUX_BUILD
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <chrono>
 namespace application{
+    // an IN_MOVED_FROM waiting for the IN_MOVED_TO with the same cookie, the pair can be split over two reads
+    struct pending_move{
+        std::filesystem::path src;
+        bool is_dir{false};
+        std::chrono::steady_clock::time_point seen;
+    };
+
+    struct DS_resources {
+        // the buffer is left uninitialized, every read fills the part that is used
+        DS_resources(int fd,const copyto& dir) noexcept : m_fd{fd}, directory{dir} {}
+
+        // one inotify instance per watched tree, so an overflow only affects that tree
+        int m_fd{-1};
+        // watch descriptor to the directory it watches, inotify is not recursive so every directory gets a watch
+        std::unordered_map<int,std::filesystem::path> m_watches;
+        alignas(inotify_event) char m_buffer[MonitorBuffer]; // 10MB buffer, do not allocate this on the stack, value defined in constants.hpp
+        copyto directory;
+        // set when the queue system dropped an event of this tree, the tree is rescanned to recover it
+        bool m_rescan{false};
+        // index of directory in the queue system's job table
+        std::uint32_t m_job{};
+        // moves out of a directory that are not paired yet, by cookie
+        std::unordered_map<uint32_t,pending_move> m_moved_from;
+    };
+
     class DirectorySignal{
+    public:
+        DirectorySignal(std::shared_ptr<std::vector<copyto>> dirs_to_watch) noexcept;
+        ~DirectorySignal();
+        DirectorySignal(const DirectorySignal&) = delete;
+        DirectorySignal& operator=(const DirectorySignal&) = delete;
 
+        void monitor() noexcept;
+        uint32_t GetNotifyFilter() noexcept {return m_NotifyFilter;}
+        int GetEpoll() noexcept {return m_epoll_fd;}
+    private:
+        uint32_t m_NotifyFilter{IN_CREATE|IN_DELETE|IN_MODIFY|IN_CLOSE_WRITE|IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_ONLYDIR|IN_EXCL_UNLINK};
+        int m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        std::vector<DS_resources*> m_pMonitors;
+        std::shared_ptr<std::vector<copyto>> m_dirs;
+        bool no_watch{false};
+
+        // check if the inotify queue of a monitored tree has overflowed
+        bool Overflow(const inotify_event* pNotify) noexcept;
+
+        // adds a watch to dir and if the monitor is recursive to every directory below it.
+        // queue_entries adds every entry found below dir to the queue system, used for directories
+        // that were created or moved into the tree since files may land in them before the watch exists
+        void AddWatchTree(DS_resources* p_monitor,const std::filesystem::path& dir,bool queue_entries) noexcept;
+
+        // events were lost for p_monitor, compare its src and dst trees and queue the differences
+        void Rescan(DS_resources* p_monitor) noexcept;
+
+        // go through all the notifications read from the inotify instance
+        void ProcessDirectoryChanges(ssize_t bytes_read,DS_resources* pMonitor) noexcept;
+
+        // fills a file_event structure for a src path inside the tree watched by pMonitor
+        file_event MakeEvent(const std::filesystem::path& src,DS_resources* pMonitor) noexcept;
+
+        // adds an event to the queue system, if the queue stayed full the tree of pMonitor is marked for a rescan
+        void QueueEntry(DS_resources* pMonitor,const file_event& entry) noexcept;
+
+        // moves that waited MonitorMovePairWait without an IN_MOVED_TO, or all of them if all is true, are handled as moved out of the tree
+        void FlushMoves(DS_resources* pMonitor,bool all) noexcept;
+
+        // old_src left the tree, it is queued as a removal. a directory takes the watches at and below it along,
+        // they are removed so its later events are not reported as paths inside the tree
+        void MovedOut(DS_resources* pMonitor,const std::filesystem::path& old_src,bool is_dir) noexcept;
+
+        queue_system<file_queue_info> m_queue_processor;
     };
 }
 
@@ -380,6 +380,29 @@ void application::FileParse::CheckDirectories() noexcept{
 
 bool application::FileParse::ValidCommands(cs commands) noexcept
 {
+    // io_uring copies the files itself, it does not clone, compare, verify or use O_DIRECT.
+    // the combination is refused instead of silently ignoring the other arg
+    if((commands & cs::uring) != cs::none && (commands & (cs::reflink | cs::delta | cs::verify | cs::direct)) != cs::none){
+        return false;
+    }
+
+    // args that can be added to any combination of the commands they are listed with
+    const std::pair<cs,cs> modifiers[] = {  {cs::reflink,cs::copy | cs::fast_copy},
+                                            {cs::uring,cs::copy | cs::fast_copy},
+                                            {cs::delta,cs::copy | cs::fast_copy | cs::monitor},
+                                            {cs::verify,cs::copy | cs::fast_copy | cs::monitor},
+                                            {cs::nocache,cs::copy | cs::fast_copy | cs::monitor},
+                                            {cs::direct,cs::copy | cs::fast_copy}};
+
+    for(const auto& [arg,allowed]:modifiers){
+        if((commands & arg) != cs::none){
+            if((commands & allowed) == cs::none){
+                return false;
+            }
+            commands = static_cast<cs>(static_cast<int>(commands) & ~static_cast<int>(arg));
+        }
+    }
+
     // regular copy commands
     cs copy_combo1 = cs::copy | cs::recursive | cs::update;
     cs copy_combo2 = cs::copy | cs::recursive | cs::overwrite;
@@ -472,6 +495,30 @@ application::cs application::FileParse::ParseCopyArgs(std::istringstream &lineSt
                     }
                     break;
                 }
+                case cs::reflink:{
+                    commands |= cs::reflink;
+                    break;
+                }
+                case cs::uring:{
+                    commands |= cs::uring;
+                    break;
+                }
+                case cs::delta:{
+                    commands |= cs::delta;
+                    break;
+                }
+                case cs::verify:{
+                    commands |= cs::verify;
+                    break;
+                }
+                case cs::nocache:{
+                    commands |= cs::nocache;
+                    break;
+                }
+                case cs::direct:{
+                    commands |= cs::direct;
+                    break;
+                }
                 default:{
                     break;
                 }
@@ -586,6 +633,18 @@ application::cs application::FileParse::ParseMonitorArgs(std::istringstream &lin
                     }
                     break;
                 }
+                case cs::delta:{
+                    commands |= cs::delta;
+                    break;
+                }
+                case cs::verify:{
+                    commands |= cs::verify;
+                    break;
+                }
+                case cs::nocache:{
+                    commands |= cs::nocache;
+                    break;
+                }
                 default:{
                     break;
                 }
@@ -1,35 +1,29 @@
 #include "TM.hpp"
 
 void application::TM::join_all() noexcept{
-    for(auto& t:m_Threads){
-        if(t.joinable()){
-            try{
-                t.join();
-            }
-            catch (const std::filesystem::filesystem_error& e) {
-                // Handle filesystem related errors
-                std::cerr << "Filesystem error: " << e.what() << "\n";
-            }
-            catch(const std::runtime_error& e){
-                // the error message
-                std::cerr << e.what() << "\n";
-            }
-            catch(const std::bad_alloc& e){
-                // the error message
-                std::cerr << e.what() << "\n";
-            }
-            catch (const std::exception& e) {
-                // Catch other standard exceptions
-                std::cerr << "Standard exception: " << e.what() << "\n";
-            } catch (...) {
-                // Catch any other exceptions
-                std::cerr << "Unknown exception caught \n";
-            }
-
-        }
+    try{
+        std::unique_lock<std::mutex> local_lock(m_done_mtx);
+        m_done_cv.wait(local_lock, [this] {return m_pending.load() == 0;});
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
     }
-
-    m_Threads.clear();
 }
 
 application::SystemPerformance application::TM::GetPCspec() noexcept{
@@ -51,6 +45,57 @@ application::SystemPerformance application::TM::GetPCspec() noexcept{
 
 application::TM::TM() noexcept{
     SetWorkers();
+
+    try{
+        for(size_t i{};i<m_Workers;i++){
+            m_Queues.push_back(std::make_unique<worker_queue>());
+        }
+
+        // start the workers after all the queues exist, workers steal from every queue
+        for(size_t i{};i<m_Workers;i++){
+            m_Threads.emplace_back(&TM::worker_loop,this,i);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+application::TM::~TM(){
+    join_all();
+
+    {
+        std::lock_guard<std::mutex> local_lock(m_wake_mtx);
+        m_running = false;
+    }
+    m_wake_cv.notify_all();
+
+    for(auto& t:m_Threads){
+        if(t.joinable()){
+            t.join();
+        }
+    }
+}
+
+application::TM& application::TM::shared() noexcept{
+    static TM scheduler;
+    return scheduler;
 }
 
 void application::TM::SetWorkers() noexcept{
@@ -75,33 +120,129 @@ void application::TM::SetWorkers() noexcept{
 }
 
 bool application::TM::join_one() noexcept{
-    // only allow m_Workers threads to run at a time
-    if (m_Threads.size() >= m_Workers && m_Threads.front().joinable()) {
-        try{
-            m_Threads.front().join();  // Join the oldest thread
-        }
-        catch (const std::filesystem::filesystem_error& e) {
-            // Handle filesystem related errors
-            std::cerr << "Filesystem error: " << e.what() << "\n";
-        }
-        catch(const std::runtime_error& e){
-            // the error message
-            std::cerr << e.what() << "\n";
+    // only allow m_Workers * TaskQueueDepth tasks to wait at a time
+    const size_t limit = m_Workers * TaskQueueDepth;
+    if(m_pending.load() < limit){
+        return false;
+    }
+
+    try{
+        std::unique_lock<std::mutex> local_lock(m_done_mtx);
+        m_done_cv.wait(local_lock, [this,limit] {return m_pending.load() < limit;});
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+    return true;
+}
+
+void application::TM::push(std::function<void()> task){
+    m_pending++;
+
+    {
+        // counted before the task can be taken so m_queued never drops below zero,
+        // changed under the lock so a waiting worker can not miss it
+        std::lock_guard<std::mutex> local_lock(m_wake_mtx);
+        m_queued++;
+    }
+
+    if(t_owner == this){
+        // a task queued by a worker is most likely related to what that worker is doing, keep it local
+        worker_queue& q = *m_Queues[t_index];
+        std::lock_guard<std::mutex> local_lock(q.mtx);
+        q.tasks.push_front(std::move(task));
+    }
+    else{
+        worker_queue& q = *m_Queues[m_next++ % m_Queues.size()];
+        std::lock_guard<std::mutex> local_lock(q.mtx);
+        q.tasks.push_back(std::move(task));
+    }
+
+    m_wake_cv.notify_one();
+}
+
+bool application::TM::pop(size_t index,std::function<void()>& task) noexcept{
+    for(size_t i{};i<m_Queues.size();i++){
+        worker_queue& q = *m_Queues[(index + i) % m_Queues.size()];
+        std::lock_guard<std::mutex> local_lock(q.mtx);
+        if(q.tasks.empty()){
+            continue;
         }
-        catch(const std::bad_alloc& e){
-            // the error message
-            std::cerr << e.what() << "\n";
+
+        if(i == 0){
+            // own queue, take the newest task
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
         }
-        catch (const std::exception& e) {
-            // Catch other standard exceptions
-            std::cerr << "Standard exception: " << e.what() << "\n";
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Unknown exception caught \n";
+        else{
+            // steal the oldest task from another worker
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
         }
-        
-        m_Threads.erase(m_Threads.begin());  // Remove it from the vector
+        m_queued--;
         return true;
     }
     return false;
+}
+
+void application::TM::worker_loop(size_t index) noexcept{
+    t_owner = this;
+    t_index = index;
+
+    while(true){
+        std::function<void()> task;
+        if(pop(index,task)){
+            try{
+                task();
+            }
+            catch (const std::filesystem::filesystem_error& e) {
+                // Handle filesystem related errors
+                std::cerr << "Filesystem error: " << e.what() << "\n";
+            }
+            catch(const std::runtime_error& e){
+                // the error message
+                std::cerr << e.what() << "\n";
+            }
+            catch(const std::bad_alloc& e){
+                // the error message
+                std::cerr << e.what() << "\n";
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+            }
+
+            {
+                std::lock_guard<std::mutex> local_lock(m_done_mtx);
+                m_pending--;
+            }
+            m_done_cv.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> local_lock(m_wake_mtx);
+        m_wake_cv.wait(local_lock, [this] {return !m_running.load() || m_queued.load() > 0;});
+        if(!m_running.load() && m_queued.load() == 0){
+            return;
+        }
+    }
 }
\ No newline at end of file
@@ -6,15 +6,23 @@
 #include <exception>
 #include <functional>
 #include <filesystem>
+#include <future>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include "constants.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////
-// This header is responsible for managing threads, its a wrapper for std::thread. 
+// This header is responsible for managing threads.
 // It checks how many threads are available and determines if the system is slow, average or fast.
-// It then sets a maximum number of threads to use at one time.
+// It then starts that many long lived worker threads. Each worker has its own queue of tasks, it takes work from
+// the front of its own queue and when that is empty it steals from the back of the other workers queues.
 // It prevents high cpu usage
-// 
-// Future TODO:
-// 1. implement std::asyc so functions can return values.
+//
+// Use TM::shared() so the whole program uses one set of workers.
 ////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -52,66 +60,104 @@ namespace application{
     class TM{
     public:
         // default constructor
-        // sets the number of workers to use
+        // sets the number of workers to use and starts them
         TM() noexcept;
 
-        // joins all joinable threads
-        // causes main thread to wait until all threads finish work
+        // finishes all queued work and stops the workers
+        ~TM();
+        TM(const TM&) = delete;
+        TM& operator=(const TM&) = delete;
+
+        // the thread manager shared by the whole program
+        static TM& shared() noexcept;
+
+        // causes the calling thread to wait until all queued work is finished
+        // the workers keep running, do not call this from a task or it will wait for itself
         void join_all() noexcept;
 
-        // joins the first launched thread from do_work
-        // this is used to keep the number of working threads (m_Workers) continuously
-        // working when one thread has finished its work a new thread is launched, the total
-        // working threads will be m_Workers at any given time
+        // if m_Workers * TaskQueueDepth tasks are waiting the calling thread waits until one finishes.
+        // this is used to keep a producer (like a directory iterator) from queueing faster than the workers can keep up
+        // returns true if it had to wait
         bool join_one() noexcept; 
 
+        // queues a task, the returned future holds the return value or the exception thrown by fp
+        template <typename Function, typename... Args>
+        auto submit(Function fp, Args... args) -> std::future<std::invoke_result_t<Function,Args...>> {
+            using result_t = std::invoke_result_t<Function,Args...>;
+
+            // std::function needs a copyable object, packaged_task is move only so it is shared
+            auto task = std::make_shared<std::packaged_task<result_t()>>([fp,args...]() mutable -> result_t {
+                return std::invoke(fp,args...);
+            });
+            std::future<result_t> result = task->get_future();
+            push([task](){ (*task)(); });
+            return result;
+        }
+
         // jobs to do for the threads
         template <typename Function, typename... Args>
         void do_work_exceptions(Function fp, Args&&... args) {
-            if (m_Threads.size() < m_Workers) {
-                // Start a new thread that calls the exceptions function with fp and args...
-                m_Threads.emplace_back([fp, args...](){
-                    exceptions(fp, std::forward<Args>(args)...);
-                });
-            }
+            // the task calls the exceptions function with fp and args...
+            push([fp, args...]() mutable {
+                exceptions(fp, args...);
+            });
         }
 
         // jobs to do for the threads
         template <typename Function, typename... Args>
         void do_work(Function fp, Args&&... args) noexcept {
-            if (m_Threads.size() < m_Workers) {
-                try{
-                    // Start a new thread that calls the exceptions function with fp and args...
-                    m_Threads.emplace_back(fp,std::forward<Args>(args)...);
-                }
-                catch (const std::filesystem::filesystem_error& e) {
-                    // Handle filesystem related errors
-                    std::cerr << "Filesystem error: " << e.what() << "\n";
-                }
-                catch(const std::runtime_error& e){
-                    // the error message
-                    std::cerr << e.what() << "\n";
-                }
-                catch(const std::bad_alloc& e){
-                    // the error message
-                    std::cerr << e.what() << "\n";
-                }
-                catch (const std::exception& e) {
-                    // Catch other standard exceptions
-                    std::cerr << "Standard exception: " << e.what() << "\n";
-                } catch (...) {
-                    // Catch any other exceptions
-                    std::cerr << "Unknown exception caught \n";
-                }
+            try{
+                // the task calls the exceptions function with fp and args...
+                push([fp, args...]() mutable {
+                    exceptions(fp, args...);
+                });
+            }
+            catch (const std::filesystem::filesystem_error& e) {
+                // Handle filesystem related errors
+                std::cerr << "Filesystem error: " << e.what() << "\n";
+            }
+            catch(const std::runtime_error& e){
+                // the error message
+                std::cerr << e.what() << "\n";
+            }
+            catch(const std::bad_alloc& e){
+                // the error message
+                std::cerr << e.what() << "\n";
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
             }
         }
 
 
+        // true if the calling thread is one of the workers, a task must not wait for other tasks to finish
+        bool on_worker() const noexcept {return t_owner == this;}
+
         // returns the number of workers used by TM class specified by the pc spec
         size_t GetNumberOfWorkers() noexcept {return m_Workers;}
     private:
+        // a workers queue of tasks
+        struct worker_queue{
+            std::deque<std::function<void()>> tasks;
+            std::mutex mtx;
+        };
+
         // set the number of worker to use
         void SetWorkers() noexcept;
+
+        // adds a task to a queue and wakes a worker
+        // tasks queued by a worker go to the front of its own queue, other tasks are spread over the queues
+        void push(std::function<void()> task);
+
+        // takes a task from the front of the queue at index, if it is empty a task is stolen from the back of another queue
+        bool pop(size_t index,std::function<void()>& task) noexcept;
+
+        // the loop each worker thread runs
+        void worker_loop(size_t index) noexcept;
         
         // workers to initialize
         size_t m_Workers;
@@ -119,9 +165,36 @@ namespace application{
         // avaliable threads
         const inline static unsigned int m_TotalThreads{std::thread::hardware_concurrency()};
 
+        // one queue per worker, unique_ptr because std::mutex can not be moved
+        std::vector<std::unique_ptr<worker_queue>> m_Queues;
+
         // holds the worker threads
         std::vector<std::jthread> m_Threads;
 
+        // queue for the next task queued from outside the workers
+        std::atomic<size_t> m_next{0};
+
+        // tasks waiting in the queues
+        std::atomic<size_t> m_queued{0};
+
+        // tasks waiting in the queues plus tasks running
+        std::atomic<size_t> m_pending{0};
+
+        // false stops the workers
+        std::atomic<bool> m_running{true};
+
+        // workers sleep here when there is no work
+        std::mutex m_wake_mtx;
+        std::condition_variable m_wake_cv;
+
+        // join_all() and join_one() wait here
+        std::mutex m_done_mtx;
+        std::condition_variable m_done_cv;
+
+        // set on worker threads so push() knows which queue belongs to the calling worker
+        inline static thread_local TM* t_owner{nullptr};
+        inline static thread_local size_t t_index{0};
+
         // using the total threads, it determines the SystemPerformance enum
         static SystemPerformance GetPCspec() noexcept;
 
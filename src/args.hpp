@@ -30,7 +30,13 @@ namespace application{
         benchmark = 1 << 14,    // 16384
         create = 1 << 15,       // 32768
         four_k = 1 << 16,
-        fast = 1 << 17
+        fast = 1 << 17,
+        reflink = 1 << 18,
+        uring = 1 << 19,
+        delta = 1 << 20,
+        verify = 1 << 21,
+        nocache = 1 << 22,
+        direct = 1 << 23
     };
     using cs = cherry_script;
 
@@ -73,6 +79,12 @@ namespace application{
                                                             {"benchmark", cs::benchmark},
                                                             {"-create", cs::create},
                                                             {"-4k",cs::four_k},
-                                                            {"fast",cs::fast} };
+                                                            {"fast",cs::fast},
+                                                            {"-reflink",cs::reflink},
+                                                            {"-uring",cs::uring},
+                                                            {"-delta",cs::delta},
+                                                            {"-verify",cs::verify},
+                                                            {"-nocache",cs::nocache},
+                                                            {"-direct",cs::direct} };
     };
 }
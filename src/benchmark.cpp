@@ -30,13 +30,17 @@ void application::benchmark::speed_test(const copyto& dir,std::uintmax_t bytes)
         std::fstream bench_file;
         bench_file.open(dir.source/filename, std::ios::out | std::ios::binary); 
 
-        // write 100MB at a time
+        // write 100MB at a time, the same buffer is written every time so it is only filled once
         std::uintmax_t bytes_buffer = 1024ull * 1024 * 100;
+        application::buffer_pool::lease data = sfct_api::lease_buffer(bytes_buffer);
+        if(!data){
+            throw std::bad_alloc();
+        }
+        std::fill(data.data(), data.data() + bytes_buffer, '0');
+
         std::uintmax_t total_written{};
         while(total_written < bytes){
-            std::vector<char> data(bytes_buffer);
-            std::fill(data.begin(), data.end(), '0');
-            bench_file.write(data.data(), data.size());
+            bench_file.write(data.data(), bytes_buffer);
             total_written += bytes_buffer;
         }
         bench_file.close();
@@ -121,16 +125,33 @@ void application::benchmark::speed_test_4k(const copyto &dir, std::uintmax_t fil
     std::vector<STRING> filenames;
 
     try{
-        // create many small files
+        // every file has the same contents, one buffer is filled and shared by all the writes.
+        // the tasks hold on to it so it stays leased until the last write is done
+        auto data = std::make_shared<application::buffer_pool::lease>(sfct_api::lease_buffer(bytes_per_file));
+        if(!*data){
+            throw std::bad_alloc();
+        }
+        std::fill(data->data(), data->data() + bytes_per_file, '0');
+
+        // create many small files, the files are written on the shared thread pool
+        std::vector<std::future<void>> writes;
         for(std::uintmax_t i{};i<filesCount;i++){
             STRING filename = App_MESSAGE("benchmark_file") + TOSTRING(i) + App_MESSAGE(".dat");
             filenames.push_back(filename);
-            std::fstream bench_file;
-            bench_file.open(dir.source/filename,std::ios::out | std::ios::binary);
-            std::vector<char> data(bytes_per_file);
-            std::fill(data.begin(), data.end(), '0');
-            bench_file.write(data.data(), data.size());
-            bench_file.close();
+            writes.push_back(TM::shared().submit([data](std::filesystem::path file,std::uintmax_t size){
+                std::fstream bench_file;
+                bench_file.open(file,std::ios::out | std::ios::binary);
+                bench_file.write(data->data(), size);
+                bench_file.close();
+            },dir.source/filename,bytes_per_file));
+        }
+
+        // wait for every file before rethrowing so the clean up below never races a write
+        for(auto& w:writes){
+            w.wait();
+        }
+        for(auto& w:writes){
+            w.get();
         }
     }
     catch (const std::filesystem::filesystem_error& e) {
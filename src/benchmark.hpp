@@ -11,6 +11,7 @@
 #include "windows_helper.hpp"
 #include "constants.hpp"
 #include "sfct_api.hpp"
+#include "TM.hpp"
 
 
 namespace application{
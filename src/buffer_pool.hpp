@@ -0,0 +1,211 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "AppMacros.hpp"
+#include "constants.hpp"
+
+#if LINUX_BUILD
+#include <sys/mman.h>
+#endif
+
+/////////////////////////////////////////////////////////////////
+// A pool of equally sized, aligned buffers.
+// Copies that need a buffer lease one and hand it back when they finish,
+// so a job that copies thousands of files allocates only as many buffers
+// as it copies at the same time.
+// shared() gives the pools used by the whole process, one per power of two size.
+/////////////////////////////////////////////////////////////////
+
+namespace application{
+    class buffer_pool{
+    public:
+        // a buffer taken from the pool, it goes back to the pool when the lease is destroyed
+        class lease{
+        public:
+            lease() noexcept = default;
+
+            lease(lease&& other) noexcept
+            :m_pool(other.m_pool),m_data(other.m_data){
+                other.m_pool = nullptr;
+                other.m_data = nullptr;
+            }
+
+            lease& operator=(lease&& other) noexcept{
+                if(this != &other){
+                    release();
+                    m_pool = other.m_pool;
+                    m_data = other.m_data;
+                    other.m_pool = nullptr;
+                    other.m_data = nullptr;
+                }
+                return *this;
+            }
+
+            lease(const lease&) = delete;
+            lease& operator=(const lease&) = delete;
+
+            ~lease() noexcept{
+                release();
+            }
+
+            // nullptr if the buffer could not be allocated
+            char* data() const noexcept {return m_data;}
+
+            std::size_t size() const noexcept {return m_pool != nullptr ? m_pool->m_buffer_size : 0;}
+
+            explicit operator bool() const noexcept {return m_data != nullptr;}
+
+            // hands the buffer back to the pool before the lease is destroyed
+            void release() noexcept{
+                if(m_data != nullptr){
+                    m_pool->give_back(m_data);
+                    m_data = nullptr;
+                }
+            }
+        private:
+            friend class buffer_pool;
+
+            lease(buffer_pool* pool,char* data) noexcept
+            :m_pool(pool),m_data(data){}
+
+            buffer_pool* m_pool{nullptr};
+            char* m_data{nullptr};
+        };
+
+        // buffers of buffer_size bytes aligned to alignment, at most max_free are kept when they are not leased.
+        // huge asks for buffers backed by huge pages on linux, it is ignored unless buffer_size is a multiple of HugePageSize
+        buffer_pool(std::size_t buffer_size,std::size_t alignment,std::size_t max_free,bool huge = false) noexcept
+        :m_buffer_size(buffer_size),m_alignment(alignment),m_max_free(max_free),
+        m_huge(LINUX_BUILD && huge && buffer_size % HugePageSize == 0 && alignment <= HugePageSize){}
+
+        buffer_pool(const buffer_pool&) = delete;
+        buffer_pool& operator=(const buffer_pool&) = delete;
+
+        ~buffer_pool() noexcept{
+            for(char* buffer:m_free){
+                deallocate(buffer);
+            }
+        }
+
+        // the pool shared by the whole process for buffers of at least size bytes. sizes are rounded up to a power of two of
+        // at least SharedBufferMinSize, the buffers are page aligned and the ones of HugePageSize or larger use huge pages.
+        // nullptr if size is larger than SharedBufferMaxSize
+        static buffer_pool* shared(std::size_t size) noexcept{
+            std::size_t index{};
+            std::size_t class_size = SharedBufferMinSize;
+            while(class_size < size){
+                if(class_size >= SharedBufferMaxSize){
+                    return nullptr;
+                }
+                class_size *= 2;
+                index++;
+            }
+
+            static std::mutex pools_mtx;
+            static std::array<std::unique_ptr<buffer_pool>,64> pools;
+
+            std::lock_guard<std::mutex> local_lock(pools_mtx);
+            if(!pools[index]){
+                // the free buffers of one size add up to at most SharedPoolMaxFreeBytes, at least one is always kept
+                std::size_t max_free = std::max<std::size_t>(1,SharedPoolMaxFreeBytes / class_size);
+                pools[index].reset(new(std::nothrow) buffer_pool(class_size,SharedBufferAlignment,max_free,true));
+            }
+            return pools[index].get();
+        }
+
+        // a buffer of at least size bytes from the shared pools, check the lease, the allocation can fail
+        static lease take_shared(std::size_t size) noexcept{
+            buffer_pool* pool = shared(size);
+            if(pool == nullptr){
+                return {};
+            }
+            return pool->take();
+        }
+
+        // a free buffer, a new one is allocated if every buffer is leased. check the lease, the allocation can fail
+        lease take() noexcept{
+            {
+                std::lock_guard<std::mutex> local_lock(m_mtx);
+                if(!m_free.empty()){
+                    char* buffer = m_free.back();
+                    m_free.pop_back();
+                    return lease(this,buffer);
+                }
+            }
+
+            char* buffer = allocate();
+            if(buffer == nullptr){
+                return {};
+            }
+            return lease(this,buffer);
+        }
+
+        std::size_t buffer_size() const noexcept {return m_buffer_size;}
+
+        std::size_t alignment() const noexcept {return m_alignment;}
+
+        // true if the buffers are mapped so the kernel can back them with huge pages
+        bool huge() const noexcept {return m_huge;}
+    private:
+        char* allocate() noexcept{
+#if LINUX_BUILD
+            if(m_huge){
+                // reserved huge pages first, then transparent huge pages
+                void* p = mmap(nullptr,m_buffer_size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+                if(p == MAP_FAILED){
+                    p = mmap(nullptr,m_buffer_size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+                    if(p == MAP_FAILED){
+                        return nullptr;
+                    }
+                    madvise(p,m_buffer_size,MADV_HUGEPAGE);
+                }
+                return static_cast<char*>(p);
+            }
+#endif
+            return static_cast<char*>(::operator new(m_buffer_size,std::align_val_t(m_alignment),std::nothrow));
+        }
+
+        void deallocate(char* buffer) noexcept{
+#if LINUX_BUILD
+            if(m_huge){
+                munmap(buffer,m_buffer_size);
+                return;
+            }
+#endif
+            ::operator delete(buffer,std::align_val_t(m_alignment));
+        }
+
+        void give_back(char* buffer) noexcept{
+            {
+                std::lock_guard<std::mutex> local_lock(m_mtx);
+                if(m_free.size() < m_max_free){
+                    // push_back can throw, the capacity is reserved up front so it never reallocates here
+                    if(m_free.capacity() < m_max_free){
+                        try{
+                            m_free.reserve(m_max_free);
+                        }
+                        catch(...){}
+                    }
+                    if(m_free.size() < m_free.capacity()){
+                        m_free.push_back(buffer);
+                        return;
+                    }
+                }
+            }
+            deallocate(buffer);
+        }
+
+        const std::size_t m_buffer_size;
+        const std::size_t m_alignment;
+        const std::size_t m_max_free;
+        const bool m_huge;
+
+        std::mutex m_mtx;
+        std::vector<char*> m_free;
+    };
+}
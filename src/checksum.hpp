@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define SFCT_CRC32C_X86 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define SFCT_CRC32C_X86 1
+#endif
+
+/////////////////////////////////////////////////////////////////
+// CRC32C (Castagnoli) used by -verify to compare the source and destination of a copy.
+// x86 cpus with SSE4.2 compute it with the crc32 instruction, 8 bytes at a time,
+// which is faster than a disk can read. Other cpus use a table, one byte at a time.
+/////////////////////////////////////////////////////////////////
+
+namespace application{
+    class crc32c{
+    public:
+        // adds length bytes at data to the checksum
+        void update(const void* data,std::size_t length) noexcept{
+#if SFCT_CRC32C_X86
+            if(hardware()){
+                m_crc = update_sse42(m_crc,static_cast<const unsigned char*>(data),length);
+                return;
+            }
+#endif
+            m_crc = update_table(m_crc,static_cast<const unsigned char*>(data),length);
+        }
+
+        // the checksum of every byte added so far
+        std::uint32_t value() const noexcept{
+            return ~m_crc;
+        }
+
+        // true if the crc32 instruction is used
+        static bool hardware() noexcept{
+#if SFCT_CRC32C_X86
+            static const bool sse42 = [](){
+#if defined(_MSC_VER)
+                int info[4]{};
+                __cpuid(info,1);
+                return (info[2] & (1 << 20)) != 0;
+#else
+                return __builtin_cpu_supports("sse4.2") != 0;
+#endif
+            }();
+            return sse42;
+#else
+            return false;
+#endif
+        }
+    private:
+        std::uint32_t m_crc{0xFFFFFFFFu};
+
+        // reflected polynomial of CRC32C
+        static constexpr std::uint32_t Polynomial = 0x82F63B78u;
+
+        static constexpr std::array<std::uint32_t,256> make_table() noexcept{
+            std::array<std::uint32_t,256> table{};
+            for(std::uint32_t i{};i<256;i++){
+                std::uint32_t crc = i;
+                for(int bit{};bit<8;bit++){
+                    crc = (crc >> 1) ^ ((crc & 1) ? Polynomial : 0);
+                }
+                table[i] = crc;
+            }
+            return table;
+        }
+
+        static std::uint32_t update_table(std::uint32_t crc,const unsigned char* p,std::size_t length) noexcept{
+            static constexpr std::array<std::uint32_t,256> table = make_table();
+            for(std::size_t i{};i<length;i++){
+                crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+#if SFCT_CRC32C_X86
+#if !defined(_MSC_VER)
+        __attribute__((target("sse4.2")))
+#endif
+        static std::uint32_t update_sse42(std::uint32_t crc,const unsigned char* p,std::size_t length) noexcept{
+#if defined(__x86_64__) || defined(_M_X64)
+            std::uint64_t crc64 = crc;
+            for(;length >= 8;p += 8,length -= 8){
+                std::uint64_t word;
+                std::memcpy(&word,p,8);
+                crc64 = _mm_crc32_u64(crc64,word);
+            }
+            crc = static_cast<std::uint32_t>(crc64);
+#endif
+            for(;length >= 4;p += 4,length -= 4){
+                std::uint32_t word;
+                std::memcpy(&word,p,4);
+                crc = _mm_crc32_u32(crc,word);
+            }
+            for(;length > 0;p++,length--){
+                crc = _mm_crc32_u8(crc,*p);
+            }
+            return crc;
+        }
+#endif
+    };
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include <cstdint>
-// max file size for Windows::FastCopy
+// max file size for Windows::FastCopy and Linux::FastCopy
 inline constexpr std::uintmax_t MaxFileSize = 1024ull * 1024 * 1024; // 1GB
 
-// min file size for Windows::FastCopy
+// min file size for Windows::FastCopy and Linux::FastCopy
 inline constexpr std::uintmax_t MinFileSize = 1024ull * 1024; // 1MB
 
+// how much of a file Linux::FastCopy maps at a time
+inline constexpr std::uintmax_t MapWindowSize = 1024ull * 1024 * 64; // 64MB
+
 // test size for the benchmark standard 4k test
 inline constexpr std::uintmax_t FourKTestSize = 1024ull * 1024 * 1024; // 1GB
 
@@ -16,4 +19,91 @@ inline constexpr std::uintmax_t FourKFileNumber = 10000; // 10,000
 inline constexpr std::uintmax_t TestSize = 1024ull * 1024 * 1024; // 1GB
 
 // monitor buffer size
-inline constexpr std::uintmax_t MonitorBuffer = 1024ull * 1024 * 10; // 10MB
\ No newline at end of file
+inline constexpr std::uintmax_t MonitorBuffer = 1024ull * 1024 * 10; // 10MB
+
+// milliseconds a monitored path has to be quiet before its coalesced event is processed
+inline constexpr std::uintmax_t MonitorQuietPeriod = 2000; // 2 seconds
+
+// milliseconds a monitored path has to be quiet after its writer closed it, a writer that opens it again right away restarts the wait
+inline constexpr std::uintmax_t MonitorCloseQuietPeriod = 250;
+
+// milliseconds a monitored path can keep changing before its coalesced event is processed anyway
+inline constexpr std::uintmax_t MonitorMaxDelay = 30000; // 30 seconds
+
+// milliseconds before a monitored entry that was not ready (in use) is tried again, doubled after every failed try
+inline constexpr std::uintmax_t MonitorRetryMinDelay = 250;
+
+// the longest wait between tries of a monitored entry that is not ready
+inline constexpr std::uintmax_t MonitorRetryMaxDelay = 30000; // 30 seconds
+
+// events the monitor queue can hold before the watcher threads have to wait, rounded up to a power of two
+inline constexpr std::uintmax_t MonitorQueueCapacity = 16384;
+
+// milliseconds a watcher thread waits for room in a full monitor queue before the event is dropped and the tree is rescanned
+inline constexpr std::uintmax_t MonitorQueueFullWait = 500;
+
+// milliseconds a linux monitor waits for the IN_MOVED_TO that pairs with an IN_MOVED_FROM before the entry counts as moved out of the tree
+inline constexpr std::uintmax_t MonitorMovePairWait = 50;
+
+// milliseconds between saves of the sync index of a monitor -sync job while it changes
+inline constexpr std::uintmax_t SyncIndexSaveInterval = 60000; // 1 minute
+
+// entries a sync index reconciliation checks between draining the monitor queue
+inline constexpr std::uintmax_t SyncIndexIngestInterval = 1024;
+
+// files this size or larger have their blocks reserved with fallocate before they are written, smaller files do not fragment
+inline constexpr std::uintmax_t PreallocateMinSize = 1024ull * 1024; // 1MB
+
+// buffer size for the read/write copy loop when the kernel can not copy a file
+inline constexpr std::uintmax_t CopyBufferSize = 1024ull * 1024; // 1MB
+
+// tasks that can wait per TM worker before TM::join_one() makes the producer wait
+inline constexpr std::uintmax_t TaskQueueDepth = 64;
+
+// files this size or larger are split into chunks that several TM workers copy at the same time
+inline constexpr std::uintmax_t ChunkedCopyMinSize = 1024ull * 1024 * 1024; // 1GB
+
+// size of each chunk of a chunked copy, a multiple of the filesystem block size
+inline constexpr std::uintmax_t CopyChunkSize = 1024ull * 1024 * 64; // 64MB
+
+// operations the io_uring copy engine keeps in flight, one buffer of UringBufferSize each
+inline constexpr std::uintmax_t UringQueueDepth = 64;
+
+// size of each io_uring copy engine buffer, files are read and written in pieces of this size
+inline constexpr std::uintmax_t UringBufferSize = 1024ull * 256; // 256KB
+
+// files this size or larger have their transfer speed reported after a directory is copied
+inline constexpr std::uintmax_t ThroughputReportSize = 1024ull * 1024 * 256; // 256MB
+
+// -delta only compares files this size or larger, smaller files are copied whole
+inline constexpr std::uintmax_t DeltaCopyMinSize = 1024ull * 1024 * 64; // 64MB
+
+// smallest and largest block a delta copy compares and writes, the block size grows with the square root of the file size
+inline constexpr std::uintmax_t DeltaMinBlockSize = 1024ull * 4; // 4KB
+inline constexpr std::uintmax_t DeltaMaxBlockSize = 1024ull * 1024; // 1MB
+
+
+// size of each -direct copy buffer, files are read and written with O_DIRECT in pieces of this size
+inline constexpr std::uintmax_t DirectBufferSize = 1024ull * 1024 * 8; // 8MB
+
+// alignment of -direct buffers, offsets and lengths, covers the logical block size of every common device
+inline constexpr std::uintmax_t DirectAlignment = 4096; // 4KB
+
+// the smallest and largest buffers the shared buffer pools hand out, requests are rounded up to a power of two
+inline constexpr std::uintmax_t SharedBufferMinSize = 1024ull * 4; // 4KB
+inline constexpr std::uintmax_t SharedBufferMaxSize = 1024ull * 1024 * 1024; // 1GB
+
+// alignment of shared buffers, enough for O_DIRECT
+inline constexpr std::uintmax_t SharedBufferAlignment = 4096; // 4KB
+
+// bytes of free buffers each size of the shared buffer pools keeps for reuse, at least one buffer is always kept
+inline constexpr std::uintmax_t SharedPoolMaxFreeBytes = 1024ull * 1024 * 256; // 256MB
+
+// shared buffers this size or larger are backed by huge pages on linux, the x86 huge page size
+inline constexpr std::uintmax_t HugePageSize = 1024ull * 1024 * 2; // 2MB
+
+// files this size or smaller are copied in batches, each file with one read and one write through a single shared buffer
+inline constexpr std::uintmax_t SmallFileMaxSize = 1024ull * 64; // 64KB
+
+// files a TM worker is given at a time by a small file batch
+inline constexpr std::uintmax_t SmallFileBatchSize = 64;
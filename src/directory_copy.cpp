@@ -43,9 +43,11 @@ void application::directory_copy::fast_copy() noexcept
             STDOUT << App_MESSAGE("Total number of files: ") << di.value().FileCount << "\n";
         }
 
+        start_strategy_counts();
+
         benchmark test;
         test.start_clock();
-        sfct_api::copy_entry(dir.source,dir.destination,dir.co);
+        sfct_api::copy_entry(dir.source,dir.destination,dir.co,false,dir.commands);
         test.end_clock();
 
         double_t rate{};
@@ -54,6 +56,8 @@ void application::directory_copy::fast_copy() noexcept
         }
 
         STDOUT << App_MESSAGE("Transfer speed in MB/s: ") << rate << "\n";
+        output_strategy_counts();
+        output_file_throughput();
     }
 }
 
@@ -61,6 +65,21 @@ void application::directory_copy::copy() noexcept
 {
 
     for(const auto& dir:*m_dirs){
+
+        // -update keeps a sync index of src, if the digest of the whole tree did not change since the last copy
+        // and every entry of the index is still in dst as it was copied, there is nothing to update or repair.
+        // src is indexed before it is copied, so a file that changes during the copy is copied again next time
+        std::unique_ptr<sync_index> index;
+        if((dir.commands & cs::update) != cs::none){
+            index = std::make_unique<sync_index>(dir);
+            bool warm = index->load();
+            std::uint64_t digest = index->digest();
+            index->reconcile([](const std::filesystem::path&,const std::filesystem::path::string_type&,file_queue_status,std::filesystem::file_type){});
+            if(warm && index->digest() == digest && index->destination_matches()){
+                STDOUT << App_MESSAGE("Source unchanged since the last copy, skipping: ") << dir.source << "\n";
+                continue;
+            }
+        }
         
         auto di = sfct_api::get_directory_info(dir);
         if(di.has_value()){
@@ -70,38 +89,78 @@ void application::directory_copy::copy() noexcept
         }
 
 
+        start_strategy_counts();
+
+        // entries the walk could not place in dst, the copy failures are counted by sfct_api
+        std::uintmax_t skipped{};
+
         benchmark test;
         test.start_clock();
         if(sfct_api::recursive_flag_check(dir.commands)){
 
             try{
-                TM worker;
-                for(const auto& entry:std::filesystem::recursive_directory_iterator(dir.source)){
-                    auto dst_path = sfct_api::create_file_relative_path(entry.path(),dir.destination,dir.source,true);
+                TM& worker = TM::shared();
+
+                // small files are handed to the workers SmallFileBatchSize at a time
+                bool batching = sfct_api::batch_small_files(dir.commands);
+                std::vector<file_queue_info> batch;
+
+                // the walk passes a directory before its entries so only the destination root has to be checked,
+                // every other directory is created by create_entry_relative_path()
+                sfct_api::create_directory_paths(dir.destination);
+
+                // the tree is scanned in parallel while the files found so far are copied
+                sfct_api::walk_directory(dir.source,true,[&worker,&dir,batching,&batch,&skipped](const std::filesystem::directory_entry& entry){
+                    // the status comes from the directory listing and travels with the entry so it is not read again
+                    std::filesystem::file_status fs_src = sfct_api::get_entry_status(entry);
+                    auto dst_path = sfct_api::create_entry_relative_path(entry.path(),fs_src,dir.destination,dir.source);
                     if(dst_path.has_value()){
+                        // the directory was just created, there is nothing left to do for it
+                        if(std::filesystem::is_directory(fs_src)){
+                            return;
+                        }
+
+                        // -uring files go to the io_uring engine, it only falls back here if io_uring is not available
+                        if((dir.commands & cs::uring) != cs::none && std::filesystem::is_regular_file(fs_src)
+                            && sfct_api::uring_copy_file(entry.path(),dst_path.value(),dir.co,dir.commands)){
+                            return;
+                        }
+
                         file_queue_info _file_info;
                         _file_info.co = dir.co;
+                        _file_info.commands = dir.commands;
                         _file_info.dst = dst_path.value();
                         _file_info.fqs = file_queue_status::file_added;
-                        auto gfs_src = sfct_api::get_file_status(entry.path());
+                        _file_info.fs_src = fs_src;
                         _file_info.src = entry.path();
 
-                        if(gfs_src.has_value()){
-                            _file_info.fs_src = gfs_src.value();
+                        if(batching && std::filesystem::is_regular_file(fs_src)){
+                            batch.push_back(_file_info);
+                            if(batch.size() >= SmallFileBatchSize){
+                                worker.do_work(&directory_copy::copy_batch,batch);
+                                batch.clear();
+                            }
+                        }
+                        else{
+                            worker.do_work(&sfct_api::mt_process_file_queue_info_entry,_file_info);
                         }
-
-                        worker.do_work(&sfct_api::mt_process_file_queue_info_entry,_file_info);
                     }
                     else{
+                        skipped++;
                         logger log(App_MESSAGE("Skipping entry, failed to obtain relative path"),Error::WARNING,entry.path());
                         log.to_console();
                         log.to_log_file();
                     }
 
                     worker.join_one();
-                } 
+                });
+
+                if(!batch.empty()){
+                    worker.do_work(&directory_copy::copy_batch,batch);
+                }
 
                 worker.join_all();
+                sfct_api::uring_wait();
             }
             catch (const std::filesystem::filesystem_error& e) {
                 // Handle filesystem related errors
@@ -138,23 +197,49 @@ void application::directory_copy::copy() noexcept
         else{
 
             try{
-                TM worker;
+                TM& worker = TM::shared();
+                bool batching = sfct_api::batch_small_files(dir.commands);
+                std::vector<file_queue_info> batch;
+                sfct_api::create_directory_paths(dir.destination);
                 for(const auto& entry:std::filesystem::directory_iterator(dir.source)){
+                    std::filesystem::file_status fs_src = sfct_api::get_entry_status(entry);
+
+                    // without -recursive directories are not copied
+                    if(std::filesystem::is_directory(fs_src)){
+                        continue;
+                    }
+
+                    if((dir.commands & cs::uring) != cs::none && std::filesystem::is_regular_file(fs_src)
+                        && sfct_api::uring_copy_file(entry.path(),dir.destination/entry.path().filename(),dir.co,dir.commands)){
+                        continue;
+                    }
+
                     file_queue_info _file_info;
                     _file_info.co = dir.co;
-                    _file_info.dst = dir.destination;
+                    _file_info.commands = dir.commands;
+                    _file_info.dst = dir.destination/entry.path().filename();
                     _file_info.fqs = file_queue_status::file_added;
-                    auto gfs_src = sfct_api::get_file_status(entry.path());
+                    _file_info.fs_src = fs_src;
                     _file_info.src = entry.path();
 
-                    if(gfs_src.has_value()){
-                        _file_info.fs_src = gfs_src.value();
+                    if(batching && std::filesystem::is_regular_file(fs_src)){
+                        batch.push_back(_file_info);
+                        if(batch.size() >= SmallFileBatchSize){
+                            worker.do_work(&directory_copy::copy_batch,batch);
+                            batch.clear();
+                        }
+                    }
+                    else{
+                        worker.do_work(&sfct_api::mt_process_file_queue_info_entry,_file_info);
                     }
-
-                    worker.do_work(&sfct_api::mt_process_file_queue_info_entry,_file_info);
                     worker.join_one();
                 }
+
+                if(!batch.empty()){
+                    worker.do_work(&directory_copy::copy_batch,batch);
+                }
                 worker.join_all();
+                sfct_api::uring_wait();
             }
             catch (const std::filesystem::filesystem_error& e) {
                 // Handle filesystem related errors
@@ -189,6 +274,18 @@ void application::directory_copy::copy() noexcept
         }
         test.end_clock();
 
+        // the index is only kept if the whole job was copied, otherwise a file that failed would be skipped by the next run.
+        // a failed -verify is one of the copy failures
+        if(index){
+            if(sfct_api::get_copy_failures() - m_copy_failures + skipped == 0){
+                index->save();
+            }
+            else{
+                std::error_code e;
+                std::filesystem::remove(index->file(),e);
+            }
+        }
+
         double_t rate{};
         if(di.has_value()){
             rate = test.speed(di.value().TotalSize);
@@ -196,8 +293,135 @@ void application::directory_copy::copy() noexcept
 
         STDOUT << "\n";
         STDOUT << App_MESSAGE("Transfer speed in MB/s: ") << rate << "\n";
+        output_strategy_counts();
+        output_file_throughput();
     }
     
 }
 
+void application::directory_copy::copy_batch(std::vector<file_queue_info> batch) noexcept
+{
+    try{
+        std::vector<file_queue_info> rest = sfct_api::copy_file_batch(batch);
+
+        // rest keeps the order of batch, the files in it are displayed when their own task processes them
+        size_t next{};
+        for(const auto& entry:batch){
+            if(next < rest.size() && rest[next] == entry){
+                next++;
+                continue;
+            }
+            sfct_api::to_console(App_MESSAGE("Processing entry: "),entry.src);
+        }
 
+        // queued by a worker so they go to the front of its queue, idle workers take them from the back
+        for(const auto& entry:rest){
+            TM::shared().do_work(&sfct_api::mt_process_file_queue_info_entry,entry);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::directory_copy::start_strategy_counts() noexcept
+{
+    for(size_t i{};i<m_strategy_counts.size();i++){
+        m_strategy_counts[i] = sfct_api::get_copy_strategy_count(static_cast<copy_strategy>(i));
+    }
+    m_metadata_calls = sfct_api::get_metadata_call_count();
+    m_sparse_bytes = sfct_api::get_sparse_bytes_skipped();
+    m_delta_bytes = sfct_api::get_delta_bytes();
+    m_delta_written = sfct_api::get_delta_bytes_written();
+    m_verified_bytes = sfct_api::get_verified_bytes();
+    m_verify_failures = sfct_api::get_verify_failures();
+    m_copy_failures = sfct_api::get_copy_failures();
+    m_page_cache = sfct_api::get_page_cache_size();
+}
+
+void application::directory_copy::output_strategy_counts() noexcept
+{
+    // names in the same order as the copy_strategy enum
+    const STRING names[] = {App_MESSAGE("none"),
+                            App_MESSAGE("copy_file_range"),
+                            App_MESSAGE("sendfile"),
+                            App_MESSAGE("read/write"),
+                            App_MESSAGE("std::filesystem::copy_file"),
+                            App_MESSAGE("reflink"),
+                            App_MESSAGE("parallel chunks"),
+                            App_MESSAGE("mmap"),
+                            App_MESSAGE("io_uring"),
+                            App_MESSAGE("sparse extents"),
+                            App_MESSAGE("delta blocks"),
+                            App_MESSAGE("O_DIRECT"),
+                            App_MESSAGE("small file batches")};
+
+    for(size_t i{1};i<m_strategy_counts.size();i++){
+        std::uintmax_t count = sfct_api::get_copy_strategy_count(static_cast<copy_strategy>(i)) - m_strategy_counts[i];
+        if(count > 0){
+            STDOUT << App_MESSAGE("Files copied with ") << names[i] << App_MESSAGE(": ") << count << "\n";
+        }
+    }
+
+    STDOUT << App_MESSAGE("Metadata calls: ") << sfct_api::get_metadata_call_count() - m_metadata_calls << "\n";
+
+    std::uintmax_t sparse_bytes = sfct_api::get_sparse_bytes_skipped() - m_sparse_bytes;
+    if(sparse_bytes > 0){
+        STDOUT << App_MESSAGE("Bytes skipped in sparse file holes: ") << sparse_bytes << "\n";
+    }
+
+    std::uintmax_t delta_bytes = sfct_api::get_delta_bytes() - m_delta_bytes;
+    if(delta_bytes > 0){
+        STDOUT << App_MESSAGE("Bytes written by delta copies: ") << sfct_api::get_delta_bytes_written() - m_delta_written
+               << App_MESSAGE(" of ") << delta_bytes << "\n";
+    }
+
+    std::uintmax_t verified_bytes = sfct_api::get_verified_bytes() - m_verified_bytes;
+    std::uintmax_t verify_failures = sfct_api::get_verify_failures() - m_verify_failures;
+    if(verified_bytes > 0 || verify_failures > 0){
+        STDOUT << App_MESSAGE("Bytes verified: ") << verified_bytes << "\n";
+    }
+    if(verify_failures > 0){
+        STDOUT << App_MESSAGE("Files that failed verification: ") << verify_failures << "\n";
+    }
+
+    std::uintmax_t copy_failures = sfct_api::get_copy_failures() - m_copy_failures;
+    if(copy_failures > 0){
+        STDOUT << App_MESSAGE("Files that failed to copy: ") << copy_failures << "\n";
+    }
+
+    // other programs change the cache too, on a busy system this is only a rough measure of what the copy left behind
+    std::optional<std::uintmax_t> page_cache = sfct_api::get_page_cache_size();
+    if(m_page_cache.has_value() && page_cache.has_value()){
+        double_t change = (static_cast<double_t>(page_cache.value()) - static_cast<double_t>(m_page_cache.value())) / 1024 / 1024;
+        STDOUT << App_MESSAGE("Page cache change in MB: ") << change << "\n";
+    }
+}
+
+void application::directory_copy::output_file_throughput() noexcept
+{
+    for(const auto& result:sfct_api::take_file_throughput()){
+        double_t speed{};
+        if(result.seconds > 0.0){
+            speed = result.bytes / result.seconds / 1024 / 1024; // MB/s
+        }
+
+        STDOUT << App_MESSAGE("File: ") << result.file << App_MESSAGE(" speed in MB/s: ") << speed << "\n";
+    }
+}
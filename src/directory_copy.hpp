@@ -2,6 +2,7 @@
 #include "sfct_api.hpp"
 #include "timer.hpp"
 #include "benchmark.hpp"
+#include "sync_index.hpp"
 
 
 namespace application{
@@ -13,5 +14,41 @@ namespace application{
         void copy() noexcept;
     private:
         std::shared_ptr<std::vector<copyto>> m_dirs;
+
+        // number of files copied by each copy strategy when the current directory started copying
+        std::array<std::uintmax_t,static_cast<size_t>(copy_strategy::count)> m_strategy_counts{};
+
+        // number of sfct_api metadata calls when the current directory started copying
+        std::uintmax_t m_metadata_calls{};
+
+        // bytes of holes skipped by sparse copies when the current directory started copying
+        std::uintmax_t m_sparse_bytes{};
+
+        // size of the files updated by delta copies and the bytes written to them when the current directory started copying
+        std::uintmax_t m_delta_bytes{};
+        std::uintmax_t m_delta_written{};
+
+        // bytes -verify found to match and files it found to differ when the current directory started copying
+        std::uintmax_t m_verified_bytes{};
+        std::uintmax_t m_verify_failures{};
+
+        // copies that failed or were skipped when the current directory started copying
+        std::uintmax_t m_copy_failures{};
+
+        // memory the system used to cache file data when the current directory started copying
+        std::optional<std::uintmax_t> m_page_cache;
+
+        // saves the copy strategy, metadata call, sparse, delta, verify, failure and page cache counts before a directory is copied
+        void start_strategy_counts() noexcept;
+
+        // outputs how many files each copy strategy copied, how many metadata calls were made, how many bytes of holes were skipped,
+        // how many bytes delta copies wrote, what -verify found and how much the page cache grew since start_strategy_counts() was called
+        void output_strategy_counts() noexcept;
+
+        // outputs the transfer speed of every file of ThroughputReportSize or larger copied since the last call
+        void output_file_throughput() noexcept;
+
+        // copies a batch of small files on a TM worker, the files that are too large for the batch are queued one by one
+        static void copy_batch(std::vector<file_queue_info> batch) noexcept;
     };
 }
\ No newline at end of file
@@ -0,0 +1,1417 @@
+#pragma once
+#include "logger.hpp"
+#include "obj.hpp"
+#include "constants.hpp"
+#include "TM.hpp"
+#include "checksum.hpp"
+#include "buffer_pool.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////
+// This header contains linux specific functions
+/////////////////////////////////////////////////////////////////////////////////
+
+
+#if LINUX_BUILD
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fs.h>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <csignal>
+#include <setjmp.h>
+
+
+namespace Linux{
+    /// @brief -nocache, waits until length bytes of out_fd at offset are on the disk and drops them and the same range of in_fd
+    /// from the page cache. Pages that are still dirty can not be dropped so the writeback has to finish first.
+    /// @param in_fd the source of the range
+    /// @param out_fd the destination of the range
+    /// @param offset where the range starts in both files
+    /// @param length number of bytes in the range, nothing is done for 0
+    inline void DropRange(int in_fd,int out_fd,std::uintmax_t offset,std::uintmax_t length) noexcept {
+        if(length == 0){
+            return;
+        }
+
+        sync_file_range(out_fd,offset,length,SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(out_fd,offset,length,POSIX_FADV_DONTNEED);
+        posix_fadvise(in_fd,offset,length,POSIX_FADV_DONTNEED);
+    }
+
+    /// @brief -nocache, follows a sequential copy and drops the pages it is done with from the page cache so a bulk copy does
+    /// not evict the cache other programs depend on. Writeback of each CopyChunkSize window starts as soon as it is copied and
+    /// the window before it is waited for and dropped, so the disk keeps writing and at most two windows are in the cache.
+    /// Whatever is left is dropped when the object is destroyed.
+    class CacheDropper{
+    public:
+        CacheDropper(int in_fd,int out_fd,bool enabled) noexcept
+        :m_in_fd(in_fd),m_out_fd(out_fd),m_enabled(enabled){}
+
+        ~CacheDropper() noexcept{
+            if(m_enabled){
+                std::uintmax_t start = m_started >= CopyChunkSize ? m_started - CopyChunkSize : 0;
+                DropRange(m_in_fd,m_out_fd,start,m_offset - start);
+            }
+        }
+
+        CacheDropper(const CacheDropper&) = delete;
+        CacheDropper& operator=(const CacheDropper&) = delete;
+
+        // everything before offset has been copied
+        void advance(std::uintmax_t offset) noexcept{
+            if(!m_enabled){
+                return;
+            }
+
+            m_offset = offset;
+            while(m_offset - m_started >= CopyChunkSize){
+                sync_file_range(m_out_fd,m_started,CopyChunkSize,SYNC_FILE_RANGE_WRITE);
+                if(m_started >= CopyChunkSize){
+                    DropRange(m_in_fd,m_out_fd,m_started - CopyChunkSize,CopyChunkSize);
+                }
+                m_started += CopyChunkSize;
+            }
+        }
+
+        // the most a copy should move before calling advance()
+        std::uintmax_t step(std::uintmax_t remaining) const noexcept{
+            return m_enabled ? std::min(remaining,CopyChunkSize) : remaining;
+        }
+    private:
+        int m_in_fd,m_out_fd;
+        bool m_enabled;
+
+        // bytes copied so far and the start of the window whose writeback has not been started
+        std::uintmax_t m_offset{},m_started{};
+    };
+
+    /// @brief -verify, the CRC32C of every CopyChunkSize window of the source, computed while a copy moves the data through a
+    /// user space buffer or a mapping so VerifyCopy() only has to read dst back for those windows. A window only has a checksum if all of its
+    /// bytes were added in order, windows the kernel copied or skipped are compared with both files by VerifyCopy().
+    /// Different threads may add to different windows at the same time.
+    class SourceChecksums{
+    public:
+        explicit SourceChecksums(std::uintmax_t size) noexcept{
+            try{
+                m_windows.resize((size + CopyChunkSize - 1) / CopyChunkSize);
+            }
+            catch(...){
+                // without checksums every window is compared with both files
+                m_windows.clear();
+            }
+        }
+
+        // adds length bytes of the source at offset to the windows they are in
+        void update(std::uintmax_t offset,const void* data,std::uintmax_t length) noexcept{
+            const char* bytes = static_cast<const char*>(data);
+            while(length > 0){
+                std::uintmax_t index = offset / CopyChunkSize;
+                std::uintmax_t at = offset % CopyChunkSize;
+                std::uintmax_t piece = std::min(length,CopyChunkSize - at);
+                if(index >= m_windows.size()){
+                    return;
+                }
+
+                window& w = m_windows[index];
+                if(at != w.added){
+                    w.broken = true;
+                }
+                else if(!w.broken){
+                    w.crc.update(bytes,piece);
+                    w.added += piece;
+                }
+
+                offset += piece;
+                bytes += piece;
+                length -= piece;
+            }
+        }
+
+        // true if every one of the length bytes of window index was added, crc is set to their checksum
+        bool value(std::uintmax_t index,std::uintmax_t length,std::uint32_t& crc) const noexcept{
+            if(index >= m_windows.size() || m_windows[index].broken || m_windows[index].added != length){
+                return false;
+            }
+            crc = m_windows[index].crc.value();
+            return true;
+        }
+    private:
+        struct window{
+            application::crc32c crc;
+            std::uintmax_t added{};
+            bool broken{false};
+        };
+
+        std::vector<window> m_windows;
+    };
+
+    /// @brief copies size bytes from in_fd to out_fd starting at the current offsets of both files.
+    /// copy_file_range is tried first so the data never leaves the kernel, sendfile is next and a read/write loop through
+    /// a user space buffer is the last resort.
+    /// @param in_fd file opened for reading
+    /// @param out_fd file opened for writing
+    /// @param size the number of bytes to copy, files that report a size of 0 are read until the end of the file
+    /// @param strategy set to the strategy that copied the data
+    /// @param nocache drop the copied data from the page cache as the copy goes, see CacheDropper
+    /// @param checksums (optional) -verify, the data the read/write loop copies is added to it
+    /// @return an empty error code for no error
+    inline std::error_code CopyData(int in_fd,int out_fd,std::uintmax_t size,application::copy_strategy& strategy,bool nocache = false,
+                                    SourceChecksums* checksums = nullptr) noexcept {
+        try{
+            std::uintmax_t remaining = size;
+            CacheDropper dropper(in_fd,out_fd,nocache);
+
+            // some files like the ones in /proc report a size of 0 but have data, they can only be read
+            bool kernel_copy = size > 0;
+
+            // the offsets of both files advance with every call so a fallback continues where the last strategy stopped
+            strategy = application::copy_strategy::copy_file_range;
+            while(kernel_copy && remaining > 0){
+                ssize_t n = copy_file_range(in_fd,nullptr,out_fd,nullptr,dropper.step(remaining),0);
+                if(n > 0){
+                    remaining -= n;
+                    dropper.advance(size - remaining);
+                    continue;
+                }
+
+                // the file got smaller while it was copied
+                if(n == 0) return {};
+
+                if(errno == EINTR) continue;
+
+                // not supported by the kernel or this pair of filesystems
+                if(errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL) break;
+
+                return std::error_code(errno,std::system_category());
+            }
+
+            if(kernel_copy && remaining == 0) return {};
+
+            strategy = application::copy_strategy::sendfile;
+            while(kernel_copy && remaining > 0){
+                // sendfile moves at most 0x7ffff000 bytes per call
+                ssize_t n = sendfile(out_fd,in_fd,nullptr,std::min<std::uintmax_t>(dropper.step(remaining),0x7ffff000));
+                if(n > 0){
+                    remaining -= n;
+                    dropper.advance(size - remaining);
+                    continue;
+                }
+
+                if(n == 0) return {};
+
+                if(errno == EINTR) continue;
+
+                if(errno == EINVAL || errno == ENOSYS) break;
+
+                return std::error_code(errno,std::system_category());
+            }
+
+            if(kernel_copy && remaining == 0) return {};
+
+            strategy = application::copy_strategy::read_write;
+            application::buffer_pool::lease buffer = application::buffer_pool::take_shared(CopyBufferSize);
+            if(!buffer) throw std::bad_alloc();
+
+            // files that report a size of 0 are copied until the end, the count starts where the kernel copy stopped
+            std::uintmax_t copied = size - remaining;
+            while(true){
+                ssize_t n = read(in_fd,buffer.data(),buffer.size());
+                if(n == 0) return {};
+                if(n < 0){
+                    if(errno == EINTR) continue;
+                    return std::error_code(errno,std::system_category());
+                }
+
+                // write can be partial
+                ssize_t written{};
+                while(written < n){
+                    ssize_t w = write(out_fd,buffer.data() + written,n - written);
+                    if(w < 0){
+                        if(errno == EINTR) continue;
+                        return std::error_code(errno,std::system_category());
+                    }
+                    written += w;
+                }
+
+                if(checksums != nullptr){
+                    checksums->update(copied,buffer.data(),n);
+                }
+                copied += n;
+                dropper.advance(copied);
+            }
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::exception& e) {
+            // Catch other standard exceptions
+            std::cerr << "Standard exception: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::io_error);
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    /// @brief copies length bytes at offset from in_fd to out_fd without moving the file offsets, so many threads can copy
+    /// different ranges of the same files at once. copy_file_range is tried first and pread/pwrite is the fallback.
+    /// @param in_fd file opened for reading
+    /// @param out_fd file opened for writing
+    /// @param offset where the range starts in both files
+    /// @param length number of bytes in the range
+    /// @param read_write set to true if the range was copied with pread/pwrite
+    /// @param copied (optional) set to the bytes copied, less than length if the source ended inside the range
+    /// @param checksums (optional) -verify, the data pread/pwrite copies is added to it
+    /// @return an empty error code for no error
+    inline std::error_code CopyRange(int in_fd,int out_fd,off_t offset,std::uintmax_t length,bool& read_write,std::uintmax_t* copied = nullptr,
+                                     SourceChecksums* checksums = nullptr) noexcept {
+        try{
+            off_t in_off = offset;
+            off_t out_off = offset;
+            std::uintmax_t remaining = length;
+            if(copied != nullptr){
+                *copied = 0;
+            }
+
+            while(!read_write && remaining > 0){
+                ssize_t n = copy_file_range(in_fd,&in_off,out_fd,&out_off,remaining,0);
+                if(n > 0){
+                    remaining -= n;
+                    if(copied != nullptr){
+                        *copied += n;
+                    }
+                    continue;
+                }
+
+                // the file got smaller while it was copied
+                if(n == 0) return {};
+
+                if(errno == EINTR) continue;
+
+                if(errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL){
+                    read_write = true;
+                    break;
+                }
+
+                return std::error_code(errno,std::system_category());
+            }
+
+            if(remaining == 0) return {};
+
+            application::buffer_pool::lease buffer = application::buffer_pool::take_shared(std::min<std::uintmax_t>(CopyBufferSize,remaining));
+            if(!buffer) throw std::bad_alloc();
+            while(remaining > 0){
+                ssize_t n = pread(in_fd,buffer.data(),std::min<std::uintmax_t>(buffer.size(),remaining),in_off);
+                if(n == 0) return {};
+                if(n < 0){
+                    if(errno == EINTR) continue;
+                    return std::error_code(errno,std::system_category());
+                }
+
+                // pwrite can be partial
+                ssize_t written{};
+                while(written < n){
+                    ssize_t w = pwrite(out_fd,buffer.data() + written,n - written,out_off + written);
+                    if(w < 0){
+                        if(errno == EINTR) continue;
+                        return std::error_code(errno,std::system_category());
+                    }
+                    written += w;
+                }
+
+                if(checksums != nullptr){
+                    checksums->update(in_off,buffer.data(),n);
+                }
+                in_off += n;
+                out_off += n;
+                remaining -= n;
+                if(copied != nullptr){
+                    *copied += n;
+                }
+            }
+            return {};
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::exception& e) {
+            // Catch other standard exceptions
+            std::cerr << "Standard exception: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::io_error);
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    /// @brief checks if a file has fewer blocks allocated than its size needs, the rest of the file is holes that read as zeros
+    /// @param st the status of the file
+    /// @return true if the file is sparse
+    inline bool IsSparse(const struct stat& st) noexcept {
+        // st_blocks is always in 512 byte units
+        return static_cast<std::uintmax_t>(st.st_blocks) * 512 < static_cast<std::uintmax_t>(st.st_size);
+    }
+
+    /// @brief copies a sparse file by finding its data extents with SEEK_DATA/SEEK_HOLE and copying only those with CopyRange().
+    /// The destination is resized to size first so the holes are never written and stay holes.
+    /// If the filesystem can not report the extents the whole file is copied with CopyData().
+    /// @param in_fd file opened for reading, the offset must be 0
+    /// @param out_fd empty file opened for writing
+    /// @param size the size of the file
+    /// @param skipped the bytes of holes that were not copied are added to it
+    /// @param strategy set to the strategy that copied the data
+    /// @param nocache drop the copied extents from the page cache as the copy goes, see CacheDropper
+    /// @param checksums (optional) -verify, the extents copied with pread/pwrite are added to it
+    /// @return an empty error code for no error
+    inline std::error_code CopySparse(int in_fd,int out_fd,std::uintmax_t size,std::uintmax_t& skipped,application::copy_strategy& strategy,
+                                      bool nocache = false,SourceChecksums* checksums = nullptr) noexcept {
+        if(ftruncate(out_fd,size) < 0){
+            return std::error_code(errno,std::system_category());
+        }
+
+        strategy = application::copy_strategy::sparse;
+        CacheDropper dropper(in_fd,out_fd,nocache);
+        bool read_write{false};
+        std::uintmax_t offset{};
+        while(offset < size){
+            off_t data = lseek(in_fd,offset,SEEK_DATA);
+            if(data < 0){
+                // no data after offset, the rest of the file is a hole. reading ahead may have cached zeros from it
+                if(errno == ENXIO){
+                    skipped += size - offset;
+                    dropper.advance(size);
+                    return {};
+                }
+
+                // SEEK_DATA is not supported, the offsets are still 0 so CopyData() copies everything
+                if(offset == 0 && (errno == EINVAL || errno == EOPNOTSUPP)){
+                    lseek(in_fd,0,SEEK_SET);
+                    return CopyData(in_fd,out_fd,size,strategy,nocache,checksums);
+                }
+
+                return std::error_code(errno,std::system_category());
+            }
+
+            off_t hole = lseek(in_fd,data,SEEK_HOLE);
+            if(hole < 0){
+                return std::error_code(errno,std::system_category());
+            }
+
+            // the file may have grown since it was opened, only size bytes are copied
+            std::uintmax_t end = std::min<std::uintmax_t>(hole,size);
+            if(static_cast<std::uintmax_t>(data) >= end){
+                skipped += size - offset;
+                dropper.advance(size);
+                return {};
+            }
+
+            // -nocache copies a long extent a window at a time so it is dropped as it goes
+            skipped += data - offset;
+            for(std::uintmax_t at = data;at < end;){
+                std::uintmax_t length = dropper.step(end - at);
+                std::error_code e = CopyRange(in_fd,out_fd,at,length,read_write,nullptr,checksums);
+                if(e){
+                    return e;
+                }
+                at += length;
+                dropper.advance(at);
+            }
+            offset = end;
+        }
+        return {};
+    }
+
+    /// @brief copies a large file in CopyChunkSize chunks, the chunks are copied at the same time by the calling thread
+    /// and application::TM::shared() workers. The destination is preallocated first so the chunks do not fragment it.
+    /// The calling thread copies chunks too and only waits for chunks that are already being copied, so it is safe to call from a TM task.
+    /// @param in_fd file opened for reading
+    /// @param out_fd file opened for writing
+    /// @param size the size of the file
+    /// @param nocache every chunk is dropped from the page cache once it is copied, see DropRange()
+    /// @param checksums (optional) -verify, the chunks copied with pread/pwrite are added to it
+    /// @return an empty error code for no error. If the source got smaller during the copy the destination is cut to where it ended.
+    inline std::error_code CopyDataChunked(int in_fd,int out_fd,std::uintmax_t size,bool nocache = false,SourceChecksums* checksums = nullptr) noexcept {
+        // shared with the helper tasks, a helper that starts late finds no chunks left and returns without touching the files
+        struct chunk_state{
+            std::atomic<std::uintmax_t> next{0};
+            std::uintmax_t chunks{};
+            std::mutex mtx;
+            std::condition_variable cv;
+            std::size_t active{};
+            std::error_code e;
+            // where the source ended if it got smaller during the copy
+            std::uintmax_t end{};
+        };
+
+        try{
+            // reserve the blocks up front, filesystems without fallocate get the size set instead
+            if(fallocate(out_fd,0,0,size) < 0 && ftruncate(out_fd,size) < 0){
+                return std::error_code(errno,std::system_category());
+            }
+
+            auto state = std::make_shared<chunk_state>();
+            state->chunks = (size + CopyChunkSize - 1) / CopyChunkSize;
+            state->end = size;
+
+            auto copy_chunks = [state,in_fd,out_fd,size,nocache,checksums](){
+                {
+                    std::lock_guard<std::mutex> local_lock(state->mtx);
+                    state->active++;
+                }
+
+                bool read_write{false};
+                for(std::uintmax_t i = state->next++;i < state->chunks;i = state->next++){
+                    std::uintmax_t offset = i * CopyChunkSize;
+                    std::uintmax_t length = std::min(CopyChunkSize,size - offset);
+                    std::uintmax_t copied{};
+                    std::error_code e = CopyRange(in_fd,out_fd,offset,length,read_write,&copied,checksums);
+                    if(nocache){
+                        DropRange(in_fd,out_fd,offset,length);
+                    }
+                    if(!e && copied < length){
+                        std::lock_guard<std::mutex> local_lock(state->mtx);
+                        state->end = std::min(state->end,offset + copied);
+                    }
+                    if(e){
+                        std::lock_guard<std::mutex> local_lock(state->mtx);
+                        if(!state->e) state->e = e;
+
+                        // the other threads stop after their current chunk
+                        state->next = state->chunks;
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> local_lock(state->mtx);
+                    state->active--;
+                }
+                state->cv.notify_all();
+            };
+
+            std::size_t helpers = std::min<std::uintmax_t>(application::TM::shared().GetNumberOfWorkers(),state->chunks - 1);
+            for(std::size_t i{};i<helpers;i++){
+                application::TM::shared().do_work(copy_chunks);
+            }
+
+            copy_chunks();
+
+            // every chunk has been taken, wait for the ones still being copied
+            std::unique_lock<std::mutex> local_lock(state->mtx);
+            state->cv.wait(local_lock,[&state](){return state->active == 0;});
+
+            // the destination was given the full size up front, without this it would keep a tail of zeros
+            if(!state->e && state->end < size && ftruncate(out_fd,state->end) < 0){
+                return std::error_code(errno,std::system_category());
+            }
+            return state->e;
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::exception& e) {
+            // Catch other standard exceptions
+            std::cerr << "Standard exception: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::io_error);
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    /// @brief the jump target of a GuardedCopy() running on this thread, nullptr when the thread is not copying a mapping
+    inline thread_local sigjmp_buf* t_sigbus_jump{nullptr};
+
+    /// @brief the SIGBUS action of the process before InstallSigbusHandler() replaced it
+    inline struct sigaction previous_sigbus_action{};
+
+    /// @brief SIGBUS handler installed by InstallSigbusHandler(). Reading a mapped page past the end of a file that was
+    /// truncated raises SIGBUS, a fault inside GuardedCopy() jumps back to it. Any other SIGBUS is passed to the action the
+    /// process had before, the default action ends the process as it would without the handler.
+    inline void SigbusHandler(int sig,siginfo_t* info,void* context) noexcept {
+        if(t_sigbus_jump != nullptr){
+            siglongjmp(*t_sigbus_jump,1);
+        }
+
+        if((previous_sigbus_action.sa_flags & SA_SIGINFO) != 0 && previous_sigbus_action.sa_sigaction != nullptr){
+            previous_sigbus_action.sa_sigaction(sig,info,context);
+            return;
+        }
+        if(previous_sigbus_action.sa_handler != SIG_DFL && previous_sigbus_action.sa_handler != SIG_IGN){
+            previous_sigbus_action.sa_handler(sig);
+            return;
+        }
+
+        // the faulting instruction runs again and gets the default action, a hardware fault can not be ignored
+        signal(sig,SIG_DFL);
+    }
+
+    /// @brief installs SigbusHandler() for the process the first time it is called, the previous action is kept for it
+    /// @return true if the handler is installed
+    inline bool InstallSigbusHandler() noexcept {
+        static const bool installed = [](){
+            struct sigaction sa{};
+            sa.sa_sigaction = SigbusHandler;
+            sa.sa_flags = SA_SIGINFO;
+            sigemptyset(&sa.sa_mask);
+            return sigaction(SIGBUS,&sa,&previous_sigbus_action) == 0;
+        }();
+        return installed;
+    }
+
+    /// @brief copies length bytes from src to dst CopyBufferSize at a time, each piece is added to checksums while it is still in the cpu cache
+    inline void CopyMapping(void* dst,const void* src,std::size_t length,SourceChecksums* checksums,std::uintmax_t offset) noexcept {
+        if(checksums == nullptr){
+            std::memcpy(dst,src,length);
+            return;
+        }
+
+        for(std::size_t at{};at < length;){
+            std::size_t piece = std::min<std::size_t>(CopyBufferSize,length - at);
+            std::memcpy(static_cast<char*>(dst) + at,static_cast<const char*>(src) + at,piece);
+            checksums->update(offset + at,static_cast<const char*>(src) + at,piece);
+            at += piece;
+        }
+    }
+
+    /// @brief copies length bytes from a mapping of a file to dst with CopyMapping(), a SIGBUS raised by reading the mapping is caught.
+    /// Only the arguments live across sigsetjmp and they are never changed, so nothing is clobbered by the jump.
+    /// InstallSigbusHandler() must have been called.
+    /// @param dst where the bytes are copied to
+    /// @param src the mapping
+    /// @param length number of bytes to copy
+    /// @param checksums (optional) -verify, the copied bytes are added to it
+    /// @param offset where the mapping starts in the file
+    /// @return false if the file behind src got smaller and the copy stopped at a page past its end
+    [[gnu::noinline]] inline bool GuardedCopy(void* dst,const void* src,std::size_t length,SourceChecksums* checksums = nullptr,std::uintmax_t offset = 0) noexcept {
+        sigjmp_buf jump;
+        if(sigsetjmp(jump,1) != 0){
+            t_sigbus_jump = nullptr;
+            return false;
+        }
+
+        // the fences keep the compiler from moving the copy outside of the guard
+        t_sigbus_jump = &jump;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        CopyMapping(dst,src,length,checksums,offset);
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        t_sigbus_jump = nullptr;
+        return true;
+    }
+
+    /// @brief linux version of Windows::FastCopy. Source and destination are memory mapped and the data is copied with memcpy.
+    /// Files are mapped MapWindowSize at a time so the address space used stays the same for any file size.
+    /// If another program truncates the source during the copy, reading past its new end raises SIGBUS. The size is checked
+    /// before each window and a fault inside a window is caught, either way the rest is copied with CopyRange() and the
+    /// destination is cut to what was copied.
+    /// @param in_fd file opened for reading
+    /// @param out_fd file opened for reading and writing, it is resized to size
+    /// @param size the size of the file
+    /// @param nocache drop the copied data from the page cache as the copy goes, see CacheDropper
+    /// @param checksums (optional) -verify, the data copied from the mappings is added to it
+    /// @return an empty error code for no error
+    inline std::error_code FastCopy(int in_fd,int out_fd,std::uintmax_t size,bool nocache = false,SourceChecksums* checksums = nullptr) noexcept {
+        if(size == 0){
+            return {};
+        }
+
+        if(ftruncate(out_fd,size) < 0){
+            return std::error_code(errno,std::system_category());
+        }
+
+        // the window is also the offset of each mapping so it must be a multiple of the page size
+        const std::uintmax_t page = sysconf(_SC_PAGESIZE);
+        const std::uintmax_t window = std::max(page,MapWindowSize - MapWindowSize % page);
+        CacheDropper dropper(in_fd,out_fd,nocache);
+
+        // the source got smaller, what is left of it is copied without a mapping and the destination ends where it does
+        auto copy_rest = [in_fd,out_fd,size,checksums](std::uintmax_t offset) -> std::error_code {
+            bool read_write{false};
+            std::uintmax_t copied{};
+            std::error_code e = CopyRange(in_fd,out_fd,offset,size - offset,read_write,&copied,checksums);
+
+            // windows copied before the truncation are cut too
+            std::uintmax_t end = offset + copied;
+            struct stat st{};
+            if(!e && fstat(in_fd,&st) == 0){
+                end = std::min<std::uintmax_t>(end,st.st_size);
+            }
+            if(!e && ftruncate(out_fd,end) < 0){
+                e = std::error_code(errno,std::system_category());
+            }
+            return e;
+        };
+
+        // without the handler a truncated source would end the process
+        if(!InstallSigbusHandler()){
+            return copy_rest(0);
+        }
+
+        for(std::uintmax_t offset{};offset < size;offset += window){
+            std::size_t length = std::min(window,size - offset);
+
+            struct stat st{};
+            if(fstat(in_fd,&st) < 0){
+                return std::error_code(errno,std::system_category());
+            }
+            if(static_cast<std::uintmax_t>(st.st_size) < offset + length){
+                return copy_rest(offset);
+            }
+
+            void* src = mmap(nullptr,length,PROT_READ,MAP_SHARED,in_fd,offset);
+            if(src == MAP_FAILED){
+                return std::error_code(errno,std::system_category());
+            }
+
+            void* dst = mmap(nullptr,length,PROT_READ | PROT_WRITE,MAP_SHARED,out_fd,offset);
+            if(dst == MAP_FAILED){
+                std::error_code e(errno,std::system_category());
+                munmap(src,length);
+                return e;
+            }
+
+            // read ahead aggressively and drop the pages behind the copy sooner
+            madvise(src,length,MADV_SEQUENTIAL);
+            madvise(dst,length,MADV_SEQUENTIAL);
+
+            bool copied = GuardedCopy(dst,src,length,checksums,offset);
+            munmap(src,length);
+            munmap(dst,length);
+            if(!copied){
+                // the source was truncated while this window was copied
+                return copy_rest(offset);
+            }
+            dropper.advance(offset + length);
+        }
+
+        return {};
+    }
+
+    /// @brief the block size a delta copy of a file of size bytes uses. Like rsync it grows with the square root of the size,
+    /// rounded up to a power of two between DeltaMinBlockSize and DeltaMaxBlockSize. Small blocks write less when a few bytes
+    /// change, large blocks keep the number of writes low when a lot of the file changed.
+    /// @param size the size of the file
+    /// @return the block size in bytes
+    inline std::uintmax_t DeltaBlockSize(std::uintmax_t size) noexcept {
+        std::uintmax_t root = static_cast<std::uintmax_t>(std::sqrt(static_cast<double>(size)));
+        std::uintmax_t block = DeltaMinBlockSize;
+        while(block < root && block < DeltaMaxBlockSize){
+            block *= 2;
+        }
+        return block;
+    }
+
+    /// @brief updates an existing destination in place. Both files are read a window at a time and compared block by block,
+    /// only the blocks that differ are written, runs of them with one pwrite. The destination is cut to size if it was larger.
+    /// If no block differs the modification time of the destination is still set so -update does not compare it again.
+    /// @param in_fd file opened for reading
+    /// @param out_fd the existing destination opened for reading and writing, not truncated
+    /// @param size the size of the source
+    /// @param written the bytes written to the destination are added to it
+    /// @param nocache drop both files from the page cache as the comparison goes, see CacheDropper
+    /// @param checksums (optional) -verify, every window of the source that is read is added to it
+    /// @return an empty error code for no error
+    inline std::error_code CopyDelta(int in_fd,int out_fd,std::uintmax_t size,std::uintmax_t& written,bool nocache = false,
+                                     SourceChecksums* checksums = nullptr) noexcept {
+        try{
+            CacheDropper dropper(in_fd,out_fd,nocache);
+            const std::uintmax_t block = DeltaBlockSize(size);
+
+            // a whole number of blocks, both limits are powers of two so this is CopyBufferSize unless the block is larger
+            const std::uintmax_t window = std::max(block,CopyBufferSize - CopyBufferSize % block);
+            application::buffer_pool::lease src_buffer = application::buffer_pool::take_shared(window);
+            application::buffer_pool::lease dst_buffer = application::buffer_pool::take_shared(window);
+            if(!src_buffer || !dst_buffer) throw std::bad_alloc();
+
+            // reads up to length bytes at offset, fewer only at the end of the file
+            auto read_full = [](int fd,char* buffer,std::uintmax_t length,std::uintmax_t offset,std::uintmax_t& got) -> std::error_code{
+                got = 0;
+                while(got < length){
+                    ssize_t n = pread(fd,buffer + got,length - got,offset + got);
+                    if(n == 0) break;
+                    if(n < 0){
+                        if(errno == EINTR) continue;
+                        return std::error_code(errno,std::system_category());
+                    }
+                    got += n;
+                }
+                return {};
+            };
+
+            auto write_full = [out_fd](const char* buffer,std::uintmax_t length,std::uintmax_t offset) -> std::error_code{
+                std::uintmax_t done{};
+                while(done < length){
+                    ssize_t w = pwrite(out_fd,buffer + done,length - done,offset + done);
+                    if(w < 0){
+                        if(errno == EINTR) continue;
+                        return std::error_code(errno,std::system_category());
+                    }
+                    done += w;
+                }
+                return {};
+            };
+
+            const std::uintmax_t written_before = written;
+            for(std::uintmax_t offset{};offset < size;offset += window){
+                std::uintmax_t src_got{},dst_got{};
+                std::error_code e = read_full(in_fd,src_buffer.data(),std::min(window,size - offset),offset,src_got);
+                if(e) return e;
+
+                // the file got smaller while it was copied
+                if(src_got == 0) break;
+
+                if(checksums != nullptr){
+                    checksums->update(offset,src_buffer.data(),src_got);
+                }
+
+                e = read_full(out_fd,dst_buffer.data(),src_got,offset,dst_got);
+                if(e) return e;
+
+                // start of the current run of blocks that differ, src_got if there is none
+                std::uintmax_t run = src_got;
+                for(std::uintmax_t at{};at < src_got;at += block){
+                    std::uintmax_t length = std::min(block,src_got - at);
+                    bool same = at + length <= dst_got && std::memcmp(src_buffer.data() + at,dst_buffer.data() + at,length) == 0;
+
+                    if(!same && run == src_got){
+                        run = at;
+                    }
+                    else if(same && run != src_got){
+                        e = write_full(src_buffer.data() + run,at - run,offset + run);
+                        if(e) return e;
+                        written += at - run;
+                        run = src_got;
+                    }
+                }
+
+                if(run != src_got){
+                    e = write_full(src_buffer.data() + run,src_got - run,offset + run);
+                    if(e) return e;
+                    written += src_got - run;
+                }
+                dropper.advance(offset + src_got);
+            }
+
+            // the old destination was larger, drop its tail
+            struct stat dst_st{};
+            if(fstat(out_fd,&dst_st) == 0 && static_cast<std::uintmax_t>(dst_st.st_size) > size && ftruncate(out_fd,size) < 0){
+                return std::error_code(errno,std::system_category());
+            }
+
+            if(written == written_before){
+                futimens(out_fd,nullptr);
+            }
+            return {};
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::exception& e) {
+            // Catch other standard exceptions
+            std::cerr << "Standard exception: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::io_error);
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    /// @brief -verify, reads dst back and compares it with src a CopyChunkSize window at a time. A window the copy computed the
+    /// checksum of in checksums is compared by the CRC32C of dst, so src is not read again. Every other window is read from both
+    /// files and compared with memcmp. The copy just read src and wrote dst so both are usually still in the page cache and
+    /// this costs a pass over memory, not over the disk.
+    /// @param in_fd file opened for reading
+    /// @param out_fd file opened for reading
+    /// @param size the size of the source
+    /// @param match set to true if dst has the size and the data of src
+    /// @param checksums (optional) the checksums of src the copy computed
+    /// @return an empty error code for no error
+    inline std::error_code VerifyCopy(int in_fd,int out_fd,std::uintmax_t size,bool& match,const SourceChecksums* checksums = nullptr) noexcept {
+        try{
+            match = false;
+
+            struct stat dst_st{};
+            if(fstat(out_fd,&dst_st) < 0){
+                return std::error_code(errno,std::system_category());
+            }
+            if(static_cast<std::uintmax_t>(dst_st.st_size) != size){
+                return {};
+            }
+
+            application::buffer_pool::lease src_buffer = application::buffer_pool::take_shared(CopyBufferSize);
+            application::buffer_pool::lease dst_buffer = application::buffer_pool::take_shared(CopyBufferSize);
+            if(!src_buffer || !dst_buffer) throw std::bad_alloc();
+
+            // reads exactly length bytes of fd at offset, false at an early end of the file
+            auto read_full = [](int fd,char* buffer,std::uintmax_t offset,std::uintmax_t length,std::error_code& e) -> bool{
+                std::uintmax_t got{};
+                while(got < length){
+                    ssize_t n = pread(fd,buffer + got,length - got,offset + got);
+                    if(n == 0) return false;
+                    if(n < 0){
+                        if(errno == EINTR) continue;
+                        e = std::error_code(errno,std::system_category());
+                        return false;
+                    }
+                    got += n;
+                }
+                return true;
+            };
+
+            // a window at a time so a mismatch is found without reading the rest
+            for(std::uintmax_t offset{};offset < size;offset += CopyChunkSize){
+                std::uintmax_t length = std::min(CopyChunkSize,size - offset);
+                std::uint32_t expected{};
+                bool streamed = checksums != nullptr && checksums->value(offset / CopyChunkSize,length,expected);
+
+                application::crc32c dst_crc;
+                for(std::uintmax_t at = offset;at < offset + length;){
+                    std::uintmax_t piece = std::min<std::uintmax_t>(dst_buffer.size(),offset + length - at);
+                    std::error_code e;
+                    if(!read_full(out_fd,dst_buffer.data(),at,piece,e)){
+                        return e;
+                    }
+
+                    if(streamed){
+                        dst_crc.update(dst_buffer.data(),piece);
+                    }
+                    else if(!read_full(in_fd,src_buffer.data(),at,piece,e) || std::memcmp(src_buffer.data(),dst_buffer.data(),piece) != 0){
+                        return e;
+                    }
+                    at += piece;
+                }
+
+                if(streamed && dst_crc.value() != expected){
+                    return {};
+                }
+            }
+
+            match = true;
+            return {};
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (const std::exception& e) {
+            // Catch other standard exceptions
+            std::cerr << "Standard exception: " << e.what() << "\n";
+
+            return std::make_error_code(std::errc::io_error);
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    /// @brief decides what happens to an existing dst the same way std::filesystem::copy_file() does
+    /// @param src_st the status of src
+    /// @param dst_st the status of the existing dst
+    /// @param co any copy options
+    /// @param _cfe gets std::errc::file_exists if dst is src or the copy options do not allow replacing it
+    /// @return true if dst should be replaced, false if it is kept. Skipping dst or keeping an up to date dst is not an error.
+    inline bool ReplaceExisting(const struct stat& src_st,const struct stat& dst_st,std::filesystem::copy_options co,application::copy_file_ext& _cfe) noexcept {
+        using fs_co = std::filesystem::copy_options;
+
+        bool same_file = src_st.st_dev == dst_st.st_dev && src_st.st_ino == dst_st.st_ino;
+        bool src_newer = src_st.st_mtim.tv_sec > dst_st.st_mtim.tv_sec ||
+                        (src_st.st_mtim.tv_sec == dst_st.st_mtim.tv_sec && src_st.st_mtim.tv_nsec > dst_st.st_mtim.tv_nsec);
+
+        if(same_file || (co & (fs_co::skip_existing | fs_co::overwrite_existing | fs_co::update_existing)) == fs_co::none){
+            _cfe.e = std::make_error_code(std::errc::file_exists);
+            return false;
+        }
+
+        // nothing to do, not an error
+        if((co & fs_co::skip_existing) != fs_co::none || ((co & fs_co::update_existing) != fs_co::none && !src_newer)){
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief opens src and dst for a copy. An existing dst is handled the same way std::filesystem::copy_file() handles it,
+    /// dst is truncated and gets the permissions of src.
+    /// @param src any path
+    /// @param dst any path, must include the file name
+    /// @param co any copy options
+    /// @param _cfe gets the error code and the metadata calls made
+    /// @param in_fd set to src opened for reading
+    /// @param out_fd set to dst opened for reading and writing
+    /// @param src_st set to the status of src
+    /// @param delta if it points to true, an existing regular dst is opened without truncating it when src and dst are both
+    /// DeltaCopyMinSize or larger so CopyDelta() can update it. Set to false if dst was truncated or created.
+    /// @return true if both files are open and the data should be copied. false if there was an error or nothing has to be copied,
+    /// no file is left open.
+    inline bool OpenCopyFiles(const std::filesystem::path& src,const std::filesystem::path& dst,std::filesystem::copy_options co,
+                                application::copy_file_ext& _cfe,int& in_fd,int& out_fd,struct stat& src_st,bool* delta = nullptr) noexcept {
+        in_fd = open(src.c_str(),O_RDONLY | O_CLOEXEC);
+        if(in_fd < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            return false;
+        }
+
+        _cfe.metadata_calls++;
+        if(fstat(in_fd,&src_st) < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            close(in_fd);
+            return false;
+        }
+
+        if(!S_ISREG(src_st.st_mode)){
+            _cfe.e = std::make_error_code(std::errc::not_supported);
+            close(in_fd);
+            return false;
+        }
+
+        bool in_place{false};
+        struct stat dst_st{};
+        _cfe.metadata_calls++;
+        if(stat(dst.c_str(),&dst_st) == 0){
+            if(!ReplaceExisting(src_st,dst_st,co,_cfe)){
+                close(in_fd);
+                return false;
+            }
+
+            in_place = delta != nullptr && *delta && S_ISREG(dst_st.st_mode) &&
+                        static_cast<std::uintmax_t>(src_st.st_size) >= DeltaCopyMinSize &&
+                        static_cast<std::uintmax_t>(dst_st.st_size) >= DeltaCopyMinSize;
+        }
+
+        if(delta != nullptr){
+            *delta = in_place;
+        }
+
+        // read and write so FastCopy() can map it and CopyDelta() can compare it
+        out_fd = open(dst.c_str(),O_RDWR | O_CREAT | O_CLOEXEC | (in_place ? 0 : O_TRUNC),src_st.st_mode & 07777);
+        if(out_fd < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            close(in_fd);
+            return false;
+        }
+
+        // an existing destination keeps its old permissions when it is opened, std::filesystem::copy_file() copies them
+        _cfe.metadata_calls++;
+        fchmod(out_fd,src_st.st_mode & 07777);
+        return true;
+    }
+
+    /// @brief the file mode creation mask of the process, read once from /proc/self/status. umask() can only be read by
+    /// setting it, which would race with the other threads creating files.
+    /// @return the mask, every permission bit if it can not be read so callers always set the permissions themselves
+    inline mode_t ProcessUmask() noexcept {
+        static const mode_t mask = [](){
+            mode_t m = 07777;
+            int fd = open("/proc/self/status",O_RDONLY | O_CLOEXEC);
+            if(fd < 0){
+                return m;
+            }
+
+            // the mask is one of the first lines
+            char status[4096];
+            ssize_t n = read(fd,status,sizeof(status) - 1);
+            close(fd);
+            if(n > 0){
+                status[n] = '\0';
+                const char* line = std::strstr(status,"Umask:");
+                if(line != nullptr){
+                    m = static_cast<mode_t>(std::strtoul(line + 6,nullptr,8));
+                }
+            }
+            return m;
+        }();
+        return mask;
+    }
+
+    /// @brief copies a file of at most capacity bytes with one read and one write through buffer. dst is created with O_EXCL
+    /// so a new file needs no stat, only an existing dst is checked against the copy options like OpenCopyFiles() does.
+    /// A new file gets the permissions of src when it is created, fchmod is only called if the umask removed some of them.
+    /// @param src any path
+    /// @param dst any path, must include the file name
+    /// @param co any copy options
+    /// @param buffer where the file is read to
+    /// @param capacity the size of buffer
+    /// @param _cfe gets the error code, the strategy, the size and the metadata calls made
+    /// @param verify -verify, the checksum of the data in buffer is compared with the checksum of dst read back into it.
+    /// A dst that does not match is removed
+    /// @return false if src is not a regular file or is larger than capacity, nothing was done and the file should be
+    /// copied with CopyFile(). true if _cfe has the result.
+    inline bool CopySmallFile(const std::filesystem::path& src,const std::filesystem::path& dst,std::filesystem::copy_options co,
+                                char* buffer,std::size_t capacity,application::copy_file_ext& _cfe,bool verify = false) noexcept {
+        int in_fd = open(src.c_str(),O_RDONLY | O_CLOEXEC);
+        if(in_fd < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            return true;
+        }
+
+        struct stat src_st{};
+        _cfe.metadata_calls++;
+        if(fstat(in_fd,&src_st) < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            close(in_fd);
+            return true;
+        }
+
+        if(!S_ISREG(src_st.st_mode) || static_cast<std::uintmax_t>(src_st.st_size) > capacity){
+            close(in_fd);
+            return false;
+        }
+
+        const mode_t mode = src_st.st_mode & 07777;
+        const int access = verify ? O_RDWR : O_WRONLY;
+        bool created{true};
+        int out_fd = open(dst.c_str(),access | O_CREAT | O_EXCL | O_CLOEXEC,mode);
+        if(out_fd < 0 && errno == EEXIST){
+            created = false;
+            struct stat dst_st{};
+            _cfe.metadata_calls++;
+            if(stat(dst.c_str(),&dst_st) == 0 && !ReplaceExisting(src_st,dst_st,co,_cfe)){
+                close(in_fd);
+                return true;
+            }
+            out_fd = open(dst.c_str(),access | O_CREAT | O_TRUNC | O_CLOEXEC,mode);
+        }
+        if(out_fd < 0){
+            _cfe.e = std::error_code(errno,std::system_category());
+            close(in_fd);
+            return true;
+        }
+
+        // an existing destination keeps its old permissions when it is opened
+        if(!created || (mode & ProcessUmask()) != 0){
+            _cfe.metadata_calls++;
+            fchmod(out_fd,mode);
+        }
+
+        // the whole file in one read, it only takes more if the file is read while it changes
+        std::size_t size{};
+        while(size < static_cast<std::size_t>(src_st.st_size)){
+            ssize_t n = read(in_fd,buffer + size,src_st.st_size - size);
+            if(n < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                _cfe.e = std::error_code(errno,std::system_category());
+                break;
+            }
+            if(n == 0){
+                break;
+            }
+            size += n;
+        }
+
+        std::size_t written{};
+        while(!_cfe.e && written < size){
+            ssize_t n = write(out_fd,buffer + written,size - written);
+            if(n < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                _cfe.e = std::error_code(errno,std::system_category());
+                break;
+            }
+            written += n;
+        }
+
+        // the checksum of what was copied is taken before dst is read back over it
+        if(verify && !_cfe.e){
+            application::crc32c src_crc,dst_crc;
+            src_crc.update(buffer,size);
+
+            std::size_t got{};
+            while(got < size){
+                ssize_t n = pread(out_fd,buffer + got,size - got,got);
+                if(n < 0){
+                    if(errno == EINTR){
+                        continue;
+                    }
+                    _cfe.e = std::error_code(errno,std::system_category());
+                    break;
+                }
+                if(n == 0){
+                    break;
+                }
+                got += n;
+            }
+            dst_crc.update(buffer,got);
+
+            _cfe.verified = !_cfe.e;
+            _cfe.verify_mismatch = !_cfe.e && (got != size || src_crc.value() != dst_crc.value());
+        }
+
+        close(in_fd);
+        if(close(out_fd) < 0 && !_cfe.e){
+            _cfe.e = std::error_code(errno,std::system_category());
+        }
+
+        // a bad copy would look up to date to -update, remove it so the next run copies it again
+        if(_cfe.verify_mismatch){
+            unlink(dst.c_str());
+        }
+
+        _cfe.strategy = application::copy_strategy::batched;
+        _cfe.rv = !_cfe.e && !_cfe.verify_mismatch;
+        _cfe.bytes = written;
+        return true;
+    }
+
+    /// @brief reserves the blocks of an empty destination before it is written so the filesystem can give it one contiguous
+    /// run of blocks instead of growing it write by write. The size is set to size in the same call.
+    /// @param out_fd empty file opened for writing
+    /// @param size the size the file will have
+    /// @return true if the blocks were reserved, false for small files and filesystems without fallocate, the file grows as it is written
+    inline bool Preallocate(int out_fd,std::uintmax_t size) noexcept {
+        return size >= PreallocateMinSize && fallocate(out_fd,0,0,size) == 0;
+    }
+
+    /// @brief -direct, copies a file with O_DIRECT reads and writes so its data never enters the page cache. The buffers are
+    /// DirectBufferSize and come from the shared buffer pool. Offsets and lengths are multiples of DirectAlignment, the
+    /// last piece of a file is written padded with zeros and the destination is cut to size afterwards.
+    /// @param in_fd file opened for reading, the offset must be 0
+    /// @param out_fd empty file opened for writing
+    /// @param size the size of the file
+    /// @param checksums (optional) -verify, the data that is read is added to it
+    /// @return an empty error code for no error. std::errc::not_supported if a filesystem does not support O_DIRECT, nothing
+    /// was written, the destination is still empty and both files are back in normal mode so the caller can copy the file another way.
+    /// After any other error the destination is cut to the bytes that were copied.
+    inline std::error_code CopyDirect(int in_fd,int out_fd,std::uintmax_t size,SourceChecksums* checksums = nullptr) noexcept {
+        const int in_flags = fcntl(in_fd,F_GETFL);
+        const int out_flags = fcntl(out_fd,F_GETFL);
+        auto restore = [&](){
+            fcntl(in_fd,F_SETFL,in_flags);
+            fcntl(out_fd,F_SETFL,out_flags);
+        };
+
+        // tmpfs and some network filesystems refuse O_DIRECT
+        if(in_flags < 0 || out_flags < 0 || fcntl(in_fd,F_SETFL,in_flags | O_DIRECT) < 0 || fcntl(out_fd,F_SETFL,out_flags | O_DIRECT) < 0){
+            restore();
+            return std::make_error_code(std::errc::not_supported);
+        }
+
+        application::buffer_pool::lease buffer = application::buffer_pool::take_shared(DirectBufferSize);
+        if(!buffer){
+            restore();
+            return std::make_error_code(std::errc::not_enough_memory);
+        }
+
+        std::error_code e;
+        std::uintmax_t offset{};
+        while(offset < size){
+            std::uintmax_t want = std::min<std::uintmax_t>(buffer.size(),size - offset);
+            std::uintmax_t aligned = (want + DirectAlignment - 1) / DirectAlignment * DirectAlignment;
+
+            ssize_t n = pread(in_fd,buffer.data(),aligned,offset);
+            if(n < 0){
+                if(errno == EINTR) continue;
+
+                // some filesystems accept the flag and fail the first read
+                if(errno == EINVAL && offset == 0){
+                    restore();
+                    return std::make_error_code(std::errc::not_supported);
+                }
+
+                e = std::error_code(errno,std::system_category());
+                break;
+            }
+
+            // the file got smaller while it was copied
+            if(n == 0){
+                size = offset;
+                break;
+            }
+
+            std::uintmax_t got = std::min<std::uintmax_t>(n,want);
+            if(checksums != nullptr){
+                checksums->update(offset,buffer.data(),got);
+            }
+
+            std::uintmax_t length = (got + DirectAlignment - 1) / DirectAlignment * DirectAlignment;
+            std::memset(buffer.data() + got,0,length - got);
+
+            std::uintmax_t written{};
+            while(written < length){
+                ssize_t w = pwrite(out_fd,buffer.data() + written,length - written,offset + written);
+                if(w < 0){
+                    if(errno == EINTR) continue;
+                    if(errno == EINVAL && offset == 0 && written == 0){
+                        restore();
+                        return std::make_error_code(std::errc::not_supported);
+                    }
+                    e = std::error_code(errno,std::system_category());
+                    break;
+                }
+                written += w;
+            }
+            if(e) break;
+
+            // the first write proved O_DIRECT works, a refused copy must not leave the file at its full size for the next strategy
+            if(offset == 0){
+                Preallocate(out_fd,size);
+            }
+            offset += got;
+
+            // a short read before the end means the file got smaller, a later read would be unaligned
+            if(got < want){
+                size = offset;
+                break;
+            }
+        }
+
+        restore();
+
+        // drop the padding of the last piece, or the preallocated blocks past what was copied before an error
+        if(ftruncate(out_fd,e ? offset : size) < 0 && !e){
+            e = std::error_code(errno,std::system_category());
+        }
+        return e;
+    }
+
+    /// @brief linux version of std::filesystem::copy_file(src,dst,co,error_code) that uses CopyData() to move the data.
+    /// The copy options are handled the same way std::filesystem::copy_file() handles them.
+    /// @param src any path
+    /// @param dst any path, must include the file name
+    /// @param co any copy options
+    /// @param commands the job commands. 
+    /// cs::reflink clones the file with FICLONE first, on copy on write filesystems (btrfs, xfs) the destination shares the 
+    /// data blocks of the source and no data is copied. If the clone fails the data is copied.
+    /// Sparse files are copied with CopySparse() so the holes are not written.
+    /// cs::fast_copy copies files between MinFileSize and MaxFileSize with FastCopy().
+    /// cs::delta updates an existing destination of DeltaCopyMinSize or larger with CopyDelta(), only the blocks that changed are written.
+    /// cs::verify compares the copied file with the source with VerifyCopy(), a destination that does not match is removed.
+    /// Copies that move the data through a buffer or a mapping compute the checksums of the source on the way, so only dst is read back for them.
+    /// cs::nocache drops the copied data from the page cache as the copy goes.
+    /// cs::direct copies with CopyDirect() so the data does not go through the page cache at all, sparse files included.
+    /// What cs::verify reads back is dropped from the page cache afterwards.
+    /// Files that are written from the start are preallocated with Preallocate().
+    /// @return a copy_file_ext object which contains the error code, whether the file was copied and the strategy that copied it
+    inline application::copy_file_ext CopyFile(const std::filesystem::path& src,const std::filesystem::path& dst,std::filesystem::copy_options co,application::cs commands=application::cs::none) noexcept {
+        application::copy_file_ext _cfe{false,{},application::copy_strategy::none};
+
+        bool reflink = (commands & application::cs::reflink) != application::cs::none;
+        bool fast_copy = (commands & application::cs::fast_copy) != application::cs::none;
+        bool nocache = (commands & application::cs::nocache) != application::cs::none;
+        bool direct = (commands & application::cs::direct) != application::cs::none;
+
+        // a clone shares every block so it is cheaper than comparing them
+        bool delta = (commands & application::cs::delta) != application::cs::none && !reflink;
+
+        int in_fd{-1},out_fd{-1};
+        struct stat src_st{};
+        if(!OpenCopyFiles(src,dst,co,_cfe,in_fd,out_fd,src_st,&delta)){
+            return _cfe;
+        }
+
+        const std::uintmax_t size = src_st.st_size;
+
+        // -verify, the copies that move the data through a buffer or a mapping compute the checksums of src on the way
+        bool verify = (commands & application::cs::verify) != application::cs::none;
+        std::optional<SourceChecksums> source_checksums;
+        if(verify){
+            source_checksums.emplace(size);
+        }
+        SourceChecksums* checksums = verify ? &source_checksums.value() : nullptr;
+
+        if(reflink && ioctl(out_fd,FICLONE,in_fd) == 0){
+            _cfe.strategy = application::copy_strategy::reflink;
+        }
+        else if(delta){
+            _cfe.strategy = application::copy_strategy::delta;
+            _cfe.e = CopyDelta(in_fd,out_fd,size,_cfe.delta_written,nocache,checksums);
+        }
+        // a filesystem without O_DIRECT leaves the file to the next strategy, which sets the error code again.
+        // -direct is checked before sparse files, their holes are written as zeros so the data still stays out of the page cache
+        else if(direct && size > 0 && (_cfe.e = CopyDirect(in_fd,out_fd,size,checksums)) != std::errc::not_supported){
+            _cfe.strategy = application::copy_strategy::direct;
+        }
+        else if(IsSparse(src_st)){
+            // the other strategies would write every hole as zeros
+            _cfe.e = CopySparse(in_fd,out_fd,size,_cfe.sparse_bytes,_cfe.strategy,nocache,checksums);
+        }
+        else if(fast_copy && size >= MinFileSize && size <= MaxFileSize){
+            _cfe.strategy = application::copy_strategy::mmap;
+            Preallocate(out_fd,size);
+            _cfe.e = FastCopy(in_fd,out_fd,size,nocache,checksums);
+        }
+        else if(size >= ChunkedCopyMinSize){
+            _cfe.strategy = application::copy_strategy::chunked;
+            _cfe.e = CopyDataChunked(in_fd,out_fd,size,nocache,checksums);
+        }
+        else{
+            bool preallocated = Preallocate(out_fd,size);
+            _cfe.e = CopyData(in_fd,out_fd,size,_cfe.strategy,nocache,checksums);
+
+            // the file got smaller while it was copied or the copy failed part way, the preallocated size is cut to what was written
+            off_t end = lseek(out_fd,0,SEEK_CUR);
+            if(preallocated && end >= 0 && static_cast<std::uintmax_t>(end) < size && ftruncate(out_fd,end) < 0 && !_cfe.e){
+                _cfe.e = std::error_code(errno,std::system_category());
+            }
+        }
+
+        // a clone shares the blocks of the source, there is nothing to compare
+        if(verify && !_cfe.e && _cfe.strategy != application::copy_strategy::reflink){
+            bool match{false};
+            _cfe.e = VerifyCopy(in_fd,out_fd,size,match,checksums);
+            _cfe.verified = !_cfe.e;
+            _cfe.verify_mismatch = !_cfe.e && !match;
+
+            // the reads back went through the page cache, -direct drops what they left there
+            if(direct){
+                posix_fadvise(in_fd,0,0,POSIX_FADV_DONTNEED);
+                posix_fadvise(out_fd,0,0,POSIX_FADV_DONTNEED);
+            }
+        }
+
+        close(in_fd);
+        if(close(out_fd) < 0 && !_cfe.e){
+            _cfe.e = std::error_code(errno,std::system_category());
+        }
+
+        // a bad copy would look up to date to -update, remove it so the next run copies it again
+        if(_cfe.verify_mismatch){
+            unlink(dst.c_str());
+        }
+
+        _cfe.rv = !_cfe.e && !_cfe.verify_mismatch;
+        _cfe.bytes = size;
+        return _cfe;
+    }
+}
+#endif
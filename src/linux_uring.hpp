@@ -0,0 +1,618 @@
+#pragma once
+#include "linux_helper.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////
+// This header contains the linux io_uring copy engine.
+// The engine owns one thread and one ring. Files queued with submit() are opened on the engine thread and their data is
+// moved with read/write operations on fixed buffers, up to UringQueueDepth operations are in flight across all the files.
+// The ring is set up with the raw syscalls so there is no dependency on liburing.
+/////////////////////////////////////////////////////////////////////////////////
+
+
+#if LINUX_BUILD
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+
+
+namespace Linux{
+    class UringEngine{
+    public:
+        // called on the engine thread when a file is finished, with the source path, the result and the seconds it took
+        using completion = std::function<void(const std::filesystem::path&,const application::copy_file_ext&,double_t)>;
+
+        // sets up the ring and the buffers, if io_uring is not available available() returns false
+        UringEngine(unsigned queue_depth,std::size_t buffer_size,completion done) noexcept{
+            try{
+                io_uring_params params{};
+                m_ring_fd = static_cast<int>(syscall(__NR_io_uring_setup,queue_depth,&params));
+                if(m_ring_fd < 0){
+                    // not built into the kernel, disabled by io_uring_disabled or blocked by seccomp
+                    return;
+                }
+
+                m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if(single_mmap){
+                    m_sq_size = m_cq_size = std::max(m_sq_size,m_cq_size);
+                }
+
+                m_sq_ptr = mmap(nullptr,m_sq_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_ring_fd,IORING_OFF_SQ_RING);
+                if(m_sq_ptr == MAP_FAILED){
+                    m_sq_ptr = nullptr;
+                    return;
+                }
+
+                m_cq_ptr = single_mmap ? m_sq_ptr : mmap(nullptr,m_cq_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_ring_fd,IORING_OFF_CQ_RING);
+                if(m_cq_ptr == MAP_FAILED){
+                    m_cq_ptr = nullptr;
+                    return;
+                }
+
+                m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                void* sqes = mmap(nullptr,m_sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,m_ring_fd,IORING_OFF_SQES);
+                if(sqes == MAP_FAILED){
+                    return;
+                }
+                m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+                char* sq = static_cast<char*>(m_sq_ptr);
+                m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+                char* cq = static_cast<char*>(m_cq_ptr);
+                m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+                // one buffer per operation in flight, aligned for the page cache
+                m_buffer_size = buffer_size;
+                std::vector<iovec> iovecs;
+                for(unsigned i{};i<params.sq_entries;i++){
+                    void* buffer = std::aligned_alloc(4096,m_buffer_size);
+                    if(buffer == nullptr){
+                        return;
+                    }
+                    m_buffers.push_back(static_cast<char*>(buffer));
+                    iovecs.push_back({buffer,m_buffer_size});
+                    m_slots.push_back({});
+                    m_free_slots.push_back(i);
+                }
+
+                // fixed buffers skip pinning the pages on every operation, they count against RLIMIT_MEMLOCK on older kernels
+                // so plain reads and writes are used when they can not be registered
+                m_fixed = syscall(__NR_io_uring_register,m_ring_fd,IORING_REGISTER_BUFFERS,iovecs.data(),static_cast<unsigned>(iovecs.size())) == 0;
+
+                m_done = done;
+                m_available = true;
+                m_thread = std::jthread(&UringEngine::loop,this);
+            }
+            catch (const std::bad_alloc& e) {
+                // the error message
+                std::cerr << "Allocation error: " << e.what() << "\n";
+                m_available = false;
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+                m_available = false;
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+                m_available = false;
+            }
+        }
+
+        ~UringEngine(){
+            if(m_thread.joinable()){
+                wait();
+                {
+                    std::lock_guard<std::mutex> local_lock(m_mtx);
+                    m_running = false;
+                }
+                m_cv.notify_all();
+                m_thread.join();
+            }
+
+            for(char* buffer:m_buffers){
+                std::free(buffer);
+            }
+            if(m_sqes != nullptr) munmap(m_sqes,m_sqes_size);
+            if(m_cq_ptr != nullptr && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr,m_cq_size);
+            if(m_sq_ptr != nullptr) munmap(m_sq_ptr,m_sq_size);
+            if(m_ring_fd >= 0) close(m_ring_fd);
+        }
+
+        UringEngine(const UringEngine&) = delete;
+        UringEngine& operator=(const UringEngine&) = delete;
+
+        // true if the ring was set up and files can be submitted
+        bool available() const noexcept { return m_available; }
+
+        // queues a file to be copied, waits while too many files are queued. nocache drops the file from the page cache as it is copied.
+        // returns false if the engine is not available, the file is not copied then.
+        bool submit(const std::filesystem::path& src,const std::filesystem::path& dst,std::filesystem::copy_options co,bool nocache = false) noexcept{
+            if(!m_available){
+                return false;
+            }
+
+            try{
+                std::unique_lock<std::mutex> local_lock(m_mtx);
+
+                // keep enough files queued to refill every slot but do not let the producer run ahead of the device
+                m_done_cv.wait(local_lock,[this](){return m_jobs.size() < m_slots.size() * 2;});
+                m_jobs.push_back({src,dst,co,nocache});
+                m_outstanding++;
+            }
+            catch (const std::bad_alloc& e) {
+                // the error message
+                std::cerr << "Allocation error: " << e.what() << "\n";
+                return false;
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+                return false;
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+                return false;
+            }
+
+            m_cv.notify_one();
+            return true;
+        }
+
+        // waits until every submitted file is finished
+        void wait() noexcept{
+            try{
+                std::unique_lock<std::mutex> local_lock(m_mtx);
+                m_done_cv.wait(local_lock,[this](){return m_outstanding == 0;});
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+            }
+        }
+    private:
+        // a file waiting to be opened
+        struct job{
+            std::filesystem::path src,dst;
+            std::filesystem::copy_options co;
+            bool nocache{false};
+        };
+
+        // a file being copied
+        struct file_state{
+            std::filesystem::path src;
+            int in_fd{-1},out_fd{-1};
+            std::uintmax_t size{};
+
+            // offset of the next chunk that has no slot yet
+            std::uintmax_t next_offset{};
+
+            // slots working on this file
+            unsigned inflight{};
+
+            // an operation was not supported, the rest of the file is copied with CopyRange() when inflight drops to 0
+            bool fallback{false};
+
+            // -nocache, writeback of every chunk starts when it is written and the file is dropped from the page cache when it is finished
+            bool nocache{false};
+
+            application::copy_file_ext cfe{false,{},application::copy_strategy::io_uring};
+            std::chrono::steady_clock::time_point start;
+        };
+
+        // one operation in flight, uses the buffer with the same index
+        struct slot{
+            file_state* file{nullptr};
+
+            // start of the chunk, current file offset and the end of the chunk
+            std::uintmax_t start{},offset{},end{};
+
+            // bytes read into the buffer and bytes of them already written
+            std::size_t bytes{},written{};
+            bool writing{false};
+        };
+
+        // queues a read of the rest of the chunk into the slots buffer
+        void prep_read(unsigned index) noexcept{
+            slot& s = m_slots[index];
+            s.writing = false;
+            s.bytes = 0;
+            s.written = 0;
+            prep(index,m_fixed ? IORING_OP_READ_FIXED : IORING_OP_READ,s.file->in_fd,m_buffers[index],
+                    std::min<std::uintmax_t>(m_buffer_size,s.end - s.offset),s.offset);
+        }
+
+        // queues a write of the part of the buffer that is not written yet
+        void prep_write(unsigned index) noexcept{
+            slot& s = m_slots[index];
+            s.writing = true;
+            prep(index,m_fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE,s.file->out_fd,m_buffers[index] + s.written,
+                    s.bytes - s.written,s.offset + s.written);
+        }
+
+        void prep(unsigned index,__u8 opcode,int fd,char* buffer,std::size_t length,std::uintmax_t offset) noexcept{
+            unsigned tail = *m_sq_tail;
+            unsigned entry = tail & *m_sq_mask;
+
+            io_uring_sqe* sqe = &m_sqes[entry];
+            std::memset(sqe,0,sizeof(io_uring_sqe));
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<__u64>(buffer);
+            sqe->len = static_cast<__u32>(length);
+            sqe->off = offset;
+            sqe->buf_index = static_cast<__u16>(index);
+            sqe->user_data = index;
+            m_sq_array[entry] = entry;
+
+            // the kernel reads the entry after it sees the new tail
+            std::atomic_ref<unsigned>(*m_sq_tail).store(tail + 1,std::memory_order_release);
+            m_to_submit++;
+        }
+
+        // gives a free slot the next chunk of a file, false if no file has a chunk left
+        bool fill_slot() noexcept{
+            for(auto& file:m_active){
+                if(file->fallback || file->cfe.e || file->next_offset >= file->size){
+                    continue;
+                }
+
+                unsigned index = m_free_slots.back();
+                m_free_slots.pop_back();
+
+                slot& s = m_slots[index];
+                s.file = file.get();
+                s.start = s.offset = file->next_offset;
+                s.end = std::min<std::uintmax_t>(file->size,file->next_offset + m_buffer_size);
+                file->next_offset = s.end;
+                file->inflight++;
+
+                prep_read(index);
+                return true;
+            }
+            return false;
+        }
+
+        // the slot is done with its chunk
+        void release_slot(unsigned index) noexcept{
+            m_slots[index].file->inflight--;
+            m_slots[index].file = nullptr;
+            m_free_slots.push_back(index);
+        }
+
+        // an operation failed, errors the kernel returns for unsupported operations move the file to the fallback
+        void fail(unsigned index,int error) noexcept{
+            file_state* file = m_slots[index].file;
+            if(error == EINVAL || error == EOPNOTSUPP){
+                file->fallback = true;
+            }
+            else if(!file->cfe.e){
+                file->cfe.e = std::error_code(error,std::system_category());
+            }
+            release_slot(index);
+        }
+
+        void complete(const io_uring_cqe& cqe) noexcept{
+            unsigned index = static_cast<unsigned>(cqe.user_data);
+            slot& s = m_slots[index];
+
+            if(cqe.res == -EINTR || cqe.res == -EAGAIN){
+                // try the same operation again
+                s.writing ? prep_write(index) : prep_read(index);
+                return;
+            }
+
+            if(cqe.res < 0){
+                fail(index,-cqe.res);
+                return;
+            }
+
+            // another chunk of the file failed, stop this one
+            if(s.file->cfe.e || s.file->fallback){
+                release_slot(index);
+                return;
+            }
+
+            if(!s.writing){
+                // the file got smaller while it was copied
+                if(cqe.res == 0){
+                    release_slot(index);
+                    return;
+                }
+
+                s.bytes = cqe.res;
+                prep_write(index);
+                return;
+            }
+
+            s.written += cqe.res;
+            if(s.written < s.bytes){
+                // partial write
+                prep_write(index);
+                return;
+            }
+
+            s.offset += s.bytes;
+            if(s.offset < s.end){
+                // partial read, read the rest of the chunk
+                prep_read(index);
+                return;
+            }
+
+            // the source chunk is clean and can go now, the destination is dropped once its writeback finished in finish_files()
+            if(s.file->nocache){
+                sync_file_range(s.file->out_fd,s.start,s.end - s.start,SYNC_FILE_RANGE_WRITE);
+                posix_fadvise(s.file->in_fd,s.start,s.end - s.start,POSIX_FADV_DONTNEED);
+            }
+
+            release_slot(index);
+        }
+
+        // closes the files that have no data left and no slots working on them
+        void finish_files() noexcept{
+            for(auto it = m_active.begin();it != m_active.end();){
+                file_state& file = **it;
+                bool scheduled = file.cfe.e || file.fallback || file.next_offset >= file.size;
+                if(!scheduled || file.inflight > 0){
+                    it++;
+                    continue;
+                }
+
+                if(file.fallback && !file.cfe.e){
+                    // the chunks that finished are copied again, it is simpler than tracking which ones did
+                    bool read_write{false};
+                    file.cfe.e = CopyRange(file.in_fd,file.out_fd,0,file.size,read_write);
+                    file.cfe.strategy = read_write ? application::copy_strategy::read_write : application::copy_strategy::copy_file_range;
+                }
+
+                if(file.nocache){
+                    DropRange(file.in_fd,file.out_fd,0,file.size);
+                }
+
+                close(file.in_fd);
+                if(close(file.out_fd) < 0 && !file.cfe.e){
+                    file.cfe.e = std::error_code(errno,std::system_category());
+                }
+
+                file.cfe.rv = !file.cfe.e;
+                file.cfe.bytes = file.size;
+                finish(file.src,file.cfe,file.start);
+                it = m_active.erase(it);
+            }
+        }
+
+        // reports a finished file
+        void finish(const std::filesystem::path& src,const application::copy_file_ext& cfe,std::chrono::steady_clock::time_point start) noexcept{
+            try{
+                std::chrono::duration<double_t> elapsed = std::chrono::steady_clock::now() - start;
+                if(m_done){
+                    m_done(src,cfe,elapsed.count());
+                }
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+            }
+
+            {
+                std::lock_guard<std::mutex> local_lock(m_mtx);
+                m_outstanding--;
+            }
+            m_done_cv.notify_all();
+        }
+
+        // opens a queued file, files that need no copy or fail to open are finished here
+        void open_job(const job& j) noexcept{
+            std::unique_ptr<file_state> file;
+            try{
+                file = std::make_unique<file_state>();
+                file->src = j.src;
+            }
+            catch (const std::bad_alloc& e) {
+                // the error message
+                std::cerr << "Allocation error: " << e.what() << "\n";
+
+                application::copy_file_ext cfe{false,std::make_error_code(std::errc::not_enough_memory),application::copy_strategy::io_uring};
+                finish(j.src,cfe,std::chrono::steady_clock::now());
+                return;
+            }
+            file->start = std::chrono::steady_clock::now();
+            file->nocache = j.nocache;
+
+            struct stat src_st{};
+            if(!OpenCopyFiles(j.src,j.dst,j.co,file->cfe,file->in_fd,file->out_fd,src_st)){
+                finish(file->src,file->cfe,file->start);
+                return;
+            }
+
+            file->size = src_st.st_size;
+            if(file->size == 0 || IsSparse(src_st)){
+                // empty or a file that does not report its size, like the ones in /proc.
+                // sparse files are copied extent by extent so the holes are not written
+                file->cfe.e = file->size == 0 ? CopyData(file->in_fd,file->out_fd,0,file->cfe.strategy)
+                                              : CopySparse(file->in_fd,file->out_fd,file->size,file->cfe.sparse_bytes,file->cfe.strategy,file->nocache);
+                file->cfe.bytes = file->size;
+                close(file->in_fd);
+                if(close(file->out_fd) < 0 && !file->cfe.e){
+                    file->cfe.e = std::error_code(errno,std::system_category());
+                }
+                file->cfe.rv = !file->cfe.e;
+                finish(file->src,file->cfe,file->start);
+                return;
+            }
+
+            // the ring stopped working, finish_files() copies the file with the fallback
+            if(!m_available){
+                file->fallback = true;
+            }
+
+            try{
+                m_active.push_back(std::move(file));
+            }
+            catch (const std::bad_alloc& e) {
+                // the error message
+                std::cerr << "Allocation error: " << e.what() << "\n";
+
+                close(file->in_fd);
+                close(file->out_fd);
+                file->cfe.e = std::make_error_code(std::errc::not_enough_memory);
+                finish(file->src,file->cfe,file->start);
+            }
+        }
+
+        void loop() noexcept{
+            while(true){
+                try{
+                    // open queued files while there are free slots that the open files can not use
+                    std::deque<job> jobs;
+                    {
+                        std::unique_lock<std::mutex> local_lock(m_mtx);
+                        if(m_active.empty()){
+                            m_cv.wait(local_lock,[this](){return !m_running || !m_jobs.empty();});
+                            if(!m_running && m_jobs.empty()){
+                                return;
+                            }
+                        }
+
+                        std::size_t wanted = m_free_slots.size() > m_active.size() ? m_free_slots.size() - m_active.size() : 0;
+                        while(wanted-- > 0 && !m_jobs.empty()){
+                            jobs.push_back(std::move(m_jobs.front()));
+                            m_jobs.pop_front();
+                        }
+                    }
+                    m_done_cv.notify_all();
+
+                    for(const auto& j:jobs){
+                        open_job(j);
+                    }
+
+                    while(!m_free_slots.empty() && fill_slot()){}
+
+                    unsigned inflight = static_cast<unsigned>(m_slots.size() - m_free_slots.size());
+                    if(inflight == 0){
+                        finish_files();
+                        continue;
+                    }
+
+                    // submit everything queued and wait for at least one completion
+                    int n = static_cast<int>(syscall(__NR_io_uring_enter,m_ring_fd,m_to_submit,1,IORING_ENTER_GETEVENTS,nullptr,0));
+                    if(n < 0){
+                        if(errno == EINTR || errno == EAGAIN || errno == EBUSY){
+                            continue;
+                        }
+
+                        // the ring is broken, finish every file with the fallback
+                        std::cerr << "io_uring_enter failed: " << std::error_code(errno,std::system_category()).message() << "\n";
+                        abandon();
+                        continue;
+                    }
+                    m_to_submit -= static_cast<unsigned>(n);
+
+                    unsigned head = *m_cq_head;
+                    unsigned tail = std::atomic_ref<unsigned>(*m_cq_tail).load(std::memory_order_acquire);
+                    while(head != tail){
+                        complete(m_cqes[head & *m_cq_mask]);
+                        head++;
+                    }
+                    std::atomic_ref<unsigned>(*m_cq_head).store(head,std::memory_order_release);
+
+                    finish_files();
+                }
+                catch (const std::bad_alloc& e) {
+                    // the error message
+                    std::cerr << "Allocation error: " << e.what() << "\n";
+                }
+                catch (const std::exception& e) {
+                    // Catch other standard exceptions
+                    std::cerr << "Standard exception: " << e.what() << "\n";
+                } catch (...) {
+                    // Catch any other exceptions
+                    std::cerr << "Unknown exception caught \n";
+                }
+            }
+        }
+
+        // io_uring_enter failed, the operations in flight are lost so every open file is copied with the fallback and
+        // the engine stops accepting files
+        void abandon() noexcept{
+            m_available = false;
+            for(auto& s:m_slots){
+                if(s.file != nullptr){
+                    s.file->fallback = true;
+                    s.file->inflight = 0;
+                    s.file = nullptr;
+                }
+            }
+            m_free_slots.clear();
+            for(unsigned i{};i<m_slots.size();i++){
+                m_free_slots.push_back(i);
+            }
+            m_to_submit = 0;
+            for(auto& file:m_active){
+                file->fallback = true;
+            }
+            finish_files();
+        }
+
+        int m_ring_fd{-1};
+        void* m_sq_ptr{nullptr};
+        void* m_cq_ptr{nullptr};
+        std::size_t m_sq_size{},m_cq_size{},m_sqes_size{};
+        io_uring_sqe* m_sqes{nullptr};
+        unsigned* m_sq_tail{nullptr};
+        unsigned* m_sq_mask{nullptr};
+        unsigned* m_sq_array{nullptr};
+        unsigned* m_cq_head{nullptr};
+        unsigned* m_cq_tail{nullptr};
+        unsigned* m_cq_mask{nullptr};
+        io_uring_cqe* m_cqes{nullptr};
+
+        // entries queued in the submission ring that the kernel has not taken yet
+        unsigned m_to_submit{};
+
+        // true if the buffers are registered with the ring
+        bool m_fixed{false};
+        std::atomic<bool> m_available{false};
+
+        std::size_t m_buffer_size{};
+        std::vector<char*> m_buffers;
+        std::vector<slot> m_slots;
+        std::vector<unsigned> m_free_slots;
+
+        // only used by the engine thread
+        std::deque<std::unique_ptr<file_state>> m_active;
+
+        completion m_done;
+
+        // files queued by submit()
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::condition_variable m_done_cv;
+        std::deque<job> m_jobs;
+
+        // queued and open files
+        std::size_t m_outstanding{};
+        bool m_running{true};
+
+        std::jthread m_thread;
+    };
+}
+#endif
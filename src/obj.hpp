@@ -3,6 +3,8 @@
 #include "args.hpp"
 #include <functional>
 #include <chrono>
+#include <cstdint>
+#include <cmath>
 
 /////////////////////////////////////////////////////////////////
 // This header contains common structures that are used throughout the program.
@@ -71,12 +73,59 @@ namespace application{
         std::error_code e;
     };
 
+    // how sfct_api::ext::copy_file moved the data of a file
+    enum class copy_strategy{
+        none,
+        copy_file_range,    // linux, data is copied inside the kernel and may be offloaded to the filesystem
+        sendfile,           // linux, data is copied inside the kernel through the page cache
+        read_write,         // data is copied through a user space buffer
+        std_copy,           // std::filesystem::copy_file()
+        reflink,            // linux, the destination shares the data blocks of the source (FICLONE)
+        chunked,            // linux, large files are split into chunks that are copied by several threads at once
+        mmap,               // linux, fast_copy, source and destination are memory mapped (Linux::FastCopy)
+        io_uring,           // linux, -uring, reads and writes are queued on an io_uring with many files in flight
+        sparse,             // linux, only the data extents of a sparse file are copied, the holes stay holes
+        delta,              // linux, -delta, an existing destination is compared block by block and only the blocks that differ are written
+        direct,             // linux, -direct, data is read and written with O_DIRECT through aligned buffers and never enters the page cache
+        batched,            // linux, small files are copied in batches by one worker, each with one read and one write (Linux::CopySmallFile)
+        count               // number of strategies, keep last
+    };
+
     struct copy_file_ext{
         // returned value from the function std::filesystem::copy_file()
         bool rv;
 
         // error code from the function std::filesystem::copy_file() 
         std::error_code e;
+
+        // the strategy that copied the data
+        copy_strategy strategy = copy_strategy::none;
+
+        // metadata syscalls (stat, fstat, fchmod) made to copy the file
+        std::uintmax_t metadata_calls = 0;
+
+        // size of the copied file, 0 if it is not known
+        std::uintmax_t bytes = 0;
+
+        // bytes of holes in a sparse file that were not read or written
+        std::uintmax_t sparse_bytes = 0;
+
+        // bytes a delta copy wrote to the destination, the rest of the file was already the same
+        std::uintmax_t delta_written = 0;
+
+        // -verify, the destination was read back and its checksum was compared with the source
+        bool verified = false;
+
+        // -verify, the checksums did not match. the destination was removed so it is copied again
+        bool verify_mismatch = false;
+    };
+
+    // transfer speed of one copied file
+    struct file_throughput{
+        std::filesystem::path file;
+        std::uintmax_t bytes;
+        double_t seconds;
+        copy_strategy strategy;
     };
 
     enum class file_queue_status{
@@ -91,6 +140,7 @@ namespace application{
         other_updated,
         rename_old,
         rename_new,
+        file_closed,    // a writer closed the file, linux IN_CLOSE_WRITE
         none
     };
 
@@ -106,6 +156,31 @@ namespace application{
         }
     };
 
+    // the compact form of a file_queue_info while the event waits in the queue system.
+    // the paths and options of the job are kept once in the queue system's job table, src is main_src/relative and dst is main_dst/relative
+    struct file_event{
+        std::filesystem::path::string_type relative;
+        std::uint32_t job{};
+        file_queue_status fqs{file_queue_status::none};
+        std::filesystem::file_type src_type{std::filesystem::file_type::none};
+        std::filesystem::file_type dst_type{std::filesystem::file_type::none};
+    };
+
+    // how an entry differs between a source and a destination directory, see sfct_api::diff_directories()
+    enum class diff_status{
+        added,      // only in the source
+        removed,    // only in the destination
+        changed     // in both, but the type differs or the file's size differs or the source is newer
+    };
+
+    struct directory_diff{
+        std::filesystem::path src,dst;
+        diff_status status;
+
+        // the type in the source, or in the destination for a removed entry
+        std::filesystem::file_type type;
+    };
+
     struct remove_file_ext{
         bool rv;
         std::uintmax_t files_removed;
@@ -132,16 +207,3 @@ namespace application{
         std::error_code e;
     };
 }
-
-namespace std {
-    template<>
-    struct hash<application::file_queue_info> {
-        std::size_t operator()(const application::file_queue_info& fqi) const noexcept {
-            // Compute individual hash values for two members for simplicity here
-            // and combine them using a method similar to boost::hash_combine
-            std::size_t h1 = std::hash<std::filesystem::path>{}(fqi.src);
-            std::size_t h2 = std::hash<std::filesystem::path>{}(fqi.dst);
-            return h1 ^ (h2 << 1); // Simple example of combining hashes
-        }
-    };
-}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+#include <filesystem>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/////////////////////////////////////////////////////////////////
+// A set of paths stored as a tree of path components.
+// Paths that share a parent share its nodes, and everything below a
+// directory can be found or removed without touching other subtrees.
+/////////////////////////////////////////////////////////////////
+
+namespace application{
+    class path_trie{
+    public:
+        // adds p, returns false if p was already in the set
+        bool insert(const std::filesystem::path& p){
+            std::vector<node*> nodes{&m_root};
+            for(const auto& part:p){
+                if(part.empty()){
+                    continue;
+                }
+
+                auto& child = nodes.back()->children[part.native()];
+                if(!child){
+                    child = std::make_unique<node>();
+                }
+                nodes.push_back(child.get());
+            }
+
+            if(nodes.back()->member){
+                return false;
+            }
+
+            nodes.back()->member = true;
+            for(node* n:nodes){
+                n->count++;
+            }
+            return true;
+        }
+
+        // true if p itself is in the set
+        bool contains(const std::filesystem::path& p) const{
+            const node* n = find(p);
+            return n != nullptr && n->member;
+        }
+
+        // true if p or anything below it is in the set
+        bool contains_under(const std::filesystem::path& p) const{
+            const node* n = find(p);
+            return n != nullptr && n->count != 0;
+        }
+
+        // removes p but not the paths below it, returns false if p was not in the set
+        bool erase(const std::filesystem::path& p){
+            std::vector<node*> nodes;
+            if(!find_nodes(p,nodes) || !nodes.back()->member){
+                return false;
+            }
+
+            nodes.back()->member = false;
+            release(p,nodes,1);
+            return true;
+        }
+
+        // removes p and every path below it, only the removed nodes are visited.
+        // returns the number of paths removed
+        std::size_t erase_subtree(const std::filesystem::path& p){
+            std::vector<node*> nodes;
+            if(!find_nodes(p,nodes) || nodes.back()->count == 0){
+                return 0;
+            }
+
+            std::size_t removed = nodes.back()->count;
+            nodes.back()->member = false;
+            nodes.back()->children.clear();
+            release(p,nodes,removed);
+            return removed;
+        }
+
+        // the number of paths in the set
+        std::size_t size() const noexcept{
+            return m_root.count;
+        }
+
+        bool empty() const noexcept{
+            return m_root.count == 0;
+        }
+
+        void clear() noexcept{
+            m_root.children.clear();
+            m_root.member = false;
+            m_root.count = 0;
+        }
+    private:
+        struct node{
+            std::unordered_map<std::filesystem::path::string_type,std::unique_ptr<node>> children;
+
+            // paths in the set at or below this node
+            std::size_t count{0};
+
+            // the path ending at this node is in the set, not just a parent of one
+            bool member{false};
+        };
+
+        node m_root;
+
+        const node* find(const std::filesystem::path& p) const{
+            const node* n = &m_root;
+            for(const auto& part:p){
+                if(part.empty()){
+                    continue;
+                }
+
+                auto child = n->children.find(part.native());
+                if(child == n->children.end()){
+                    return nullptr;
+                }
+                n = child->second.get();
+            }
+            return n;
+        }
+
+        // fills nodes with the root and every node down to p, returns false if p has no node
+        bool find_nodes(const std::filesystem::path& p,std::vector<node*>& nodes){
+            nodes.push_back(&m_root);
+            for(const auto& part:p){
+                if(part.empty()){
+                    continue;
+                }
+
+                auto child = nodes.back()->children.find(part.native());
+                if(child == nodes.back()->children.end()){
+                    return false;
+                }
+                nodes.push_back(child->second.get());
+            }
+            return true;
+        }
+
+        // takes removed paths off the counts along nodes and frees the nodes nothing is below any more
+        void release(const std::filesystem::path& p,std::vector<node*>& nodes,std::size_t removed){
+            for(node* n:nodes){
+                n->count -= removed;
+            }
+
+            // the component of p that leads to nodes[i] from nodes[i - 1]
+            std::vector<std::filesystem::path::string_type> parts;
+            for(const auto& part:p){
+                if(!part.empty()){
+                    parts.push_back(part.native());
+                }
+            }
+
+            for(std::size_t i = nodes.size() - 1; i > 0 && nodes[i]->count == 0; i--){
+                nodes[i - 1]->children.erase(parts[i - 1]);
+            }
+        }
+    };
+}
@@ -10,6 +10,15 @@
 #include "sfct_api.hpp"
 #include <filesystem>
 #include "TM.hpp"
+#include "constants.hpp"
+#include "path_trie.hpp"
+#include "sync_index.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <bit>
+#include <future>
+#include <vector>
 
 namespace application{
     template<typename data_t>
@@ -97,44 +106,166 @@ namespace application{
 
 
 
+    // bounded lock free queue for many producers and one consumer, based on Dmitry Vyukov's bounded MPMC queue.
+    // Every cell has a sequence number that tells a producer the cell is free and the consumer that the data is written.
+    template<typename data_t>
+    class mpsc_ring{
+    public:
+        // capacity is rounded up to a power of two
+        explicit mpsc_ring(std::size_t capacity)
+        :m_mask(std::bit_ceil(std::max<std::size_t>(capacity,2)) - 1),m_cells(std::make_unique<cell[]>(m_mask + 1)){
+            for(std::size_t i{};i<=m_mask;i++){
+                m_cells[i].sequence.store(i,std::memory_order_relaxed);
+            }
+        }
+
+        // returns false if the ring is full, data is taken by value so a copy that throws happens before a cell is claimed
+        bool try_push(data_t data) noexcept{
+            cell* c;
+            std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            while(true){
+                c = &m_cells[pos & m_mask];
+                std::size_t seq = c->sequence.load(std::memory_order_acquire);
+                std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if(diff == 0){
+                    if(m_enqueue_pos.compare_exchange_weak(pos,pos + 1,std::memory_order_relaxed)){
+                        break;
+                    }
+                }
+                else if(diff < 0){
+                    // the consumer has not freed this cell yet
+                    return false;
+                }
+                else{
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            c->data = std::move(data);
+            c->sequence.store(pos + 1,std::memory_order_release);
+
+            std::size_t used = pos + 1 - m_dequeue_pos.load(std::memory_order_relaxed);
+            std::size_t high = m_high_water.load(std::memory_order_relaxed);
+            while(used > high && !m_high_water.compare_exchange_weak(high,used,std::memory_order_relaxed)){}
+            return true;
+        }
+
+        // only one thread may pop, returns false if there is nothing to take
+        bool try_pop(data_t& data) noexcept{
+            std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            cell* c = &m_cells[pos & m_mask];
+            if(c->sequence.load(std::memory_order_acquire) != pos + 1){
+                return false;
+            }
+
+            data = std::move(c->data);
+            c->sequence.store(pos + m_mask + 1,std::memory_order_release);
+            m_dequeue_pos.store(pos + 1,std::memory_order_relaxed);
+            return true;
+        }
+
+        bool empty() const noexcept{
+            std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+        }
+
+        std::size_t capacity() const noexcept{ return m_mask + 1; }
+
+        // the most entries that were waiting in the ring at once
+        std::size_t high_water() const noexcept{ return m_high_water.load(std::memory_order_relaxed); }
+    private:
+        struct cell{
+            std::atomic<std::size_t> sequence;
+            data_t data;
+        };
+
+        const std::size_t m_mask;
+        std::unique_ptr<cell[]> m_cells;
+
+        // producers and the consumer work on different cache lines
+        alignas(64) std::atomic<std::size_t> m_enqueue_pos{0};
+        alignas(64) std::atomic<std::size_t> m_dequeue_pos{0};
+        alignas(64) std::atomic<std::size_t> m_high_water{0};
+    };
+
+    // the jobs of the monitored directories, a queued event refers to its job by index instead of carrying the job's paths and options.
+    // jobs are never removed, so a reference stays valid for the life of the table
+    class job_table{
+    public:
+        // returns the index of job, adding it if it is not in the table yet
+        std::uint32_t intern(const copyto& job){
+            std::lock_guard<std::mutex> local_lock(m_mtx);
+            for(std::size_t i = 0; i < m_jobs.size(); i++){
+                if(copyto_equal(*m_jobs[i],job)){
+                    return static_cast<std::uint32_t>(i);
+                }
+            }
+
+            m_jobs.push_back(std::make_unique<copyto>(job));
+            return static_cast<std::uint32_t>(m_jobs.size() - 1);
+        }
+
+        const copyto& operator[](std::uint32_t index) const{
+            std::lock_guard<std::mutex> local_lock(m_mtx);
+            return *m_jobs.at(index);
+        }
+    private:
+        mutable std::mutex m_mtx;
+        std::vector<std::unique_ptr<copyto>> m_jobs;
+    };
+
+
     template<>
     class queue_system<file_queue_info>{
         public:
         void process() noexcept{
-            while(m_running){
+            open_indexes();
+
+            while(true){
             
                 try{
-                    if(m_ready_to_process.load()){
-                        while(!m_queue.empty()){
-                            file_queue_info entry = m_queue.front();
-                            process_entry(entry);
-                            m_queue.pop();
-                        }
-                        m_ready_to_process = false;
-                        m_main_thread_cv.notify_one();
-                    }
-                    else{
+                    ingest();
 
-                        if(!m_still_wait_data.empty()){
-                            m_wait_data.swap(m_still_wait_data);
+                    {
+                        std::unique_lock<std::mutex> local_lock(m_queue_buffer_mtx);
 
-                            while(!m_wait_data.empty()){
-                                file_queue_info entry = m_wait_data.front();
-                                process_entry(entry);
-                                m_wait_data.pop();
-                            }
-                        }
-                        
-                        check();
+                        // wake up when the next path goes quiet, when the next entry that was not ready is tried again or when the sync indexes are saved
+                        auto wake = std::min({next_deadline(),next_retry(),next_index_save()});
 
-                        {   
-                            std::unique_lock<std::mutex> local_lock(m_local_thread_guard);
-                            m_local_thread_cv.wait(local_lock, [this] {return m_ready_to_process.load();});
+                        // producers only wake the processor after they see m_sleeping, so the ring is checked again after it is set
+                        m_sleeping = true;
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        auto ready = [this]{
+                            return !m_running.load() || !m_ring.empty() || !m_queue_buffer.empty() || next_deadline() <= std::chrono::steady_clock::now();
+                        };
+                        if(wake == std::chrono::steady_clock::time_point::max()){
+                            m_local_thread_cv.wait(local_lock,ready);
+                        }
+                        else{
+                            m_local_thread_cv.wait_until(local_lock,wake,ready);
                         }
-                        
-                        std::lock_guard<std::mutex> local_lock(m_queue_buffer_mtx);
-                        m_queue.swap(m_queue_buffer);
+                        m_sleeping = false;
                     }
+
+                    ingest();
+
+                    // after exit() nothing waits for its path to go quiet
+                    bool stopping = !m_running.load();
+                    take_due_entries(stopping ? std::chrono::steady_clock::time_point::max() : std::chrono::steady_clock::now());
+                    if(stopping && m_queue_buffer.empty()){
+                        save_indexes(true);
+                        return;
+                    }
+                    m_queue.swap(m_queue_buffer);
+                    dispatch(m_queue);
+
+                    take_due_retries(std::chrono::steady_clock::now());
+                    dispatch(m_wait_data);
+                    finish_retries();
+                    
+                    check();
+
+                    save_indexes(false);
                 }
                 catch (const std::filesystem::filesystem_error& e) {
                     // Handle filesystem related errors
@@ -158,10 +289,38 @@ namespace application{
             }
         }
 
-        void add_to_queue(const file_queue_info& entry) noexcept{
+        // adds the job of a monitored directory, its events refer to it by the returned index
+        std::uint32_t add_job(const copyto& dir){
+            return m_jobs.intern(dir);
+        }
+
+        // keeps a sync index for job, the job is reconciled with it when process() starts. Call before process()
+        void use_index(std::uint32_t job){
+            if(!m_indexes.contains(job)){
+                m_indexes.emplace(job,std::make_unique<sync_index>(m_jobs[job]));
+            }
+        }
+
+        // pushes an event into the lock free ring, safe to call from any number of watcher threads.
+        // If the ring is full the caller waits up to MonitorQueueFullWait for the processor to make room.
+        // returns false if the event was dropped, the caller has to rescan to recover it
+        bool add_to_queue(const file_event& entry) noexcept{
             try{
-                std::lock_guard<std::mutex> local_lock(m_queue_buffer_mtx);
-                m_queue_buffer.emplace(entry);
+                auto give_up = std::chrono::steady_clock::now() + std::chrono::milliseconds(MonitorQueueFullWait);
+                while(!m_ring.try_push(entry)){
+                    wake_processor();
+                    if(std::chrono::steady_clock::now() >= give_up){
+                        m_dropped++;
+                        return false;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(m_sleeping.load()){
+                    wake_processor();
+                }
+                return true;
             }
             catch (const std::filesystem::filesystem_error& e) {
                 // Handle filesystem related errors
@@ -182,15 +341,25 @@ namespace application{
                 // Catch any other exceptions
                 std::cerr << "Unknown exception caught \n";
             }
+
+            m_dropped++;
+            return false;
         }
 
+        // the most events that were waiting in the ring at once
+        std::size_t high_water() const noexcept{ return m_ring.high_water(); }
+
+        // events dropped because the ring stayed full
+        std::uintmax_t dropped() const noexcept{ return m_dropped.load(); }
+
+        // the number of events the ring can hold
+        std::size_t capacity() const noexcept{ return m_ring.capacity(); }
+
         void exit(){
             try{
-                // process remaining buffer
-                std::unique_lock<std::mutex> local_lock(m_main_thread_guard);
-                m_main_thread_cv.wait(local_lock, [this] {return !m_ready_to_process.load(); });
-
+                // the processor drains the ring and processes everything left without waiting for the paths to go quiet
                 m_running = false;
+                wake_processor();
             }
             catch (const std::filesystem::filesystem_error& e) {
                 // Handle filesystem related errors
@@ -217,30 +386,613 @@ namespace application{
         // used to notify the waiting thread
         std::condition_variable m_local_thread_cv;
 
-        std::atomic<bool> m_ready_to_process{false};
-
         std::atomic<bool> m_running{true};
     private:
+        // an event waiting for its path to go quiet
+        struct pending_entry{
+            file_event entry;
+
+            // when the first and the latest event for the path arrived
+            std::chrono::steady_clock::time_point first,last;
+
+            // order of the first event, entries that become due together are processed in this order
+            std::uint64_t order;
+
+            // the writer closed the file, it only waits MonitorCloseQuietPeriod
+            bool closed{false};
+        };
+
         // data ready to be processed
-        std::queue<file_queue_info> m_queue; 
+        std::queue<file_event> m_queue; 
+
+        // coalesced data ready to be processed
+        std::queue<file_event> m_queue_buffer;
 
-        std::queue<file_queue_info> m_queue_buffer;
+        // a source path, the job and the path relative to the job's source
+        struct event_key{
+            std::uint32_t job;
+            std::filesystem::path::string_type relative;
+
+            bool operator==(const event_key& other) const = default;
+        };
+
+        struct event_key_hash{
+            std::size_t operator()(const event_key& key) const noexcept{
+                return std::hash<std::filesystem::path::string_type>{}(key.relative) ^ (std::hash<std::uint32_t>{}(key.job) << 1);
+            }
+        };
+
+        // events waiting for their path to go quiet, one per source path
+        std::unordered_map<event_key,pending_entry,event_key_hash> m_pending;
+
+        // the jobs the queued events refer to
+        job_table m_jobs;
+
+        std::filesystem::path source_path(const file_event& event) const{
+            return m_jobs[event.job].source/event.relative;
+        }
+
+        // expands a queued event to the full entry process_entry() works on
+        file_queue_info to_entry(const file_event& event) const{
+            const copyto& job = m_jobs[event.job];
+
+            file_queue_info entry;
+            entry.src = job.source/event.relative;
+            entry.dst = job.destination/event.relative;
+            entry.main_src = job.source;
+            entry.main_dst = job.destination;
+            entry.co = job.co;
+            entry.commands = job.commands;
+            entry.fs_src = std::filesystem::file_status(event.src_type);
+            entry.fs_dst = std::filesystem::file_status(event.dst_type);
+            entry.fqs = event.fqs;
+            return entry;
+        }
+
+        static file_queue_info to_entry(file_queue_info&& entry) noexcept{
+            return std::move(entry);
+        }
+
+        std::uint64_t m_sequence{};
+
+        // an entry that was not ready, it is tried again at retry
+        struct parked_entry{
+            file_queue_info entry;
+            std::chrono::steady_clock::time_point retry;
+
+            // doubled every time the entry is still not ready
+            std::chrono::milliseconds backoff;
+
+            // set while the entry is in m_wait_data being tried again
+            bool retrying{false};
+        };
 
         // data to be proccessed later
         std::queue<file_queue_info> m_wait_data;
 
-        // data that still has to be processed later
-        std::queue<file_queue_info> m_still_wait_data;
+        // data that still has to be processed later, one per source path, guarded by m_state_mtx
+        std::unordered_map<std::filesystem::path,parked_entry> m_still_wait_data;
 
+        // guards the processor's sleep, the events themselves are never locked
         std::mutex m_queue_buffer_mtx;
 
-        std::mutex m_local_thread_guard;
-		
-        std::mutex m_main_thread_guard;
-		std::condition_variable m_main_thread_cv;
+        // events pushed by the watcher threads, only the processor thread pops them
+        mpsc_ring<file_event> m_ring{MonitorQueueCapacity};
+
+        std::atomic<std::uintmax_t> m_dropped{0};
+
+        // set while the processor thread waits on m_local_thread_cv
+        std::atomic<bool> m_sleeping{false};
+
+        void wake_processor() noexcept{
+            {
+                // taking the lock makes sure the processor is either before its last check of the ring or already waiting
+                std::lock_guard<std::mutex> local_lock(m_queue_buffer_mtx);
+            }
+            m_local_thread_cv.notify_one();
+        }
+
+        // an entry being processed on TM::shared() and the path it works on
+        struct running_entry{
+            std::filesystem::path path;
+            std::future<void> done;
+        };
+
+        // entries being processed, only used on the processor thread
+        std::vector<running_entry> m_running_entries;
+
+        // guards the state process_entry() shares between entries processed at the same time
+        std::mutex m_state_mtx;
+
+        // processes the entries on TM::shared() workers and returns when all of them are finished.
+        // an entry waits for the running entries on the same path or a path above or below it, unrelated paths run at the same time
+        template<typename event_t>
+        void dispatch(std::queue<event_t>& entries){
+            while(!entries.empty()){
+                file_queue_info entry = to_entry(std::move(entries.front()));
+                entries.pop();
+
+                if(entry.fqs == file_queue_status::rename_old || entry.fqs == file_queue_status::rename_new){
+                    // a rename moves a whole subtree and the pair shares m_rename_old, everything before it has to be finished
+                    wait_running([](const running_entry&){return true;});
+                    process_entry(entry);
+                }
+                else{
+                    wait_running([&entry](const running_entry& running){return same_subtree(running.path,entry.src);});
+
+                    // do not queue more than the workers can start soon, the rest of the batch may depend on these
+                    while(m_running_entries.size() >= TM::shared().GetNumberOfWorkers() * 2){
+                        m_running_entries.front().done.wait();
+                        wait_running([](const running_entry&){return false;});
+                    }
+
+                    m_running_entries.push_back({entry.src,TM::shared().submit(&queue_system<file_queue_info>::process_entry_task,this,entry)});
+                }
+
+                // keep the ring drained while slow entries are copied
+                ingest();
+            }
+
+            wait_running([](const running_entry&){return true;});
+        }
+
+        // waits for the running entries must_finish returns true for, and drops every entry that is finished
+        template<typename Predicate>
+        void wait_running(Predicate must_finish){
+            for(auto running = m_running_entries.begin();running != m_running_entries.end();){
+                if(must_finish(*running)){
+                    running->done.wait();
+                }
+
+                if(running->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+                    running = m_running_entries.erase(running);
+                }
+                else{
+                    running++;
+                }
+            }
+        }
+
+        // true if a and b are the same path or one is inside the other
+        static bool same_subtree(const std::filesystem::path& a,const std::filesystem::path& b){
+            auto a_part = a.begin();
+            auto b_part = b.begin();
+            for(;a_part != a.end() && b_part != b.end();a_part++,b_part++){
+                if(*a_part != *b_part){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // runs process_entry() on a worker, errors are reported here so one entry can not stop the others
+        void process_entry_task(file_queue_info entry) noexcept{
+            try{
+                process_entry(entry);
+            }
+            catch (const std::filesystem::filesystem_error& e) {
+                // Handle filesystem related errors
+                std::cerr << "Filesystem error: " << e.what() << "\n";
+            }
+            catch(const std::runtime_error& e){
+                // the error message
+                std::cerr << "Runtime error :" << e.what() << "\n";
+            }
+            catch(const std::bad_alloc& e){
+                // the error message
+                std::cerr << "Allocation error: " << e.what() << "\n";
+            }
+            catch (const std::exception& e) {
+                // Catch other standard exceptions
+                std::cerr << "Standard exception: " << e.what() << "\n";
+            } catch (...) {
+                // Catch any other exceptions
+                std::cerr << "Unknown exception caught \n";
+            }
+        }
+
+        // the entry is not ready yet, it is parked and tried again after a backoff that doubles every time it is still not ready.
+        // nothing sleeps on the entry, a writer closing it (file_closed) makes it due once the file stays closed for MonitorCloseQuietPeriod
+        void wait_later(const file_queue_info& entry){
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            auto [parked,inserted] = m_still_wait_data.try_emplace(entry.src);
+            if(inserted){
+                parked->second.backoff = std::chrono::milliseconds(MonitorRetryMinDelay);
+            }
+            else{
+                parked->second.backoff = std::min(parked->second.backoff * 2,std::chrono::milliseconds(MonitorRetryMaxDelay));
+            }
+            parked->second.entry = entry;
+            parked->second.retry = std::chrono::steady_clock::now() + parked->second.backoff;
+            parked->second.retrying = false;
+        }
+
+        // when the next parked entry should be tried again
+        std::chrono::steady_clock::time_point next_retry(){
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            auto retry = std::chrono::steady_clock::time_point::max();
+            for(const auto& [src,parked]:m_still_wait_data){
+                if(!parked.retrying){
+                    retry = std::min(retry,parked.retry);
+                }
+            }
+            return retry;
+        }
+
+        // moves the parked entries due by now to m_wait_data
+        void take_due_retries(std::chrono::steady_clock::time_point now){
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            for(auto& [src,parked]:m_still_wait_data){
+                if(!parked.retrying && parked.retry <= now){
+                    parked.retrying = true;
+                    m_wait_data.emplace(parked.entry);
+                }
+            }
+        }
+
+        // the retried entries that were not parked again are done
+        void finish_retries(){
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            std::erase_if(m_still_wait_data,[](const auto& parked){return parked.second.retrying;});
+        }
+
+        // the entry was removed, check() may copy it again if it shows up
+        void forget_entry(const file_queue_info& entry){
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            m_all_seen_entries.erase(entry.dst);
+        }
+
+        // moves every event in the ring to m_pending, only called on the processor thread
+        void ingest() noexcept{
+            file_event entry;
+            while(m_ring.try_pop(entry)){
+                ingest_entry(entry);
+            }
+        }
+
+        // merges an event into the pending event for the same path, see coalesce()
+        void ingest_entry(const file_event& entry,bool touch_index = true){
+            auto now = std::chrono::steady_clock::now();
+
+            // the directory the entry is in is read again once everything queued is processed
+            auto index = touch_index ? m_indexes.find(entry.job) : m_indexes.end();
+            if(index != m_indexes.end()){
+                index->second->touch(entry.relative);
+            }
+
+            if(entry.fqs == file_queue_status::rename_old || entry.fqs == file_queue_status::rename_new){
+                // a rename depends on everything queued before it, so nothing waits any longer and the rename keeps its place
+                take_due_entries(std::chrono::steady_clock::time_point::max());
+                m_queue_buffer.emplace(entry);
+                return;
+            }
+
+            event_key key{entry.job,entry.relative};
+            auto pending = m_pending.find(key);
+
+            if(entry.fqs == file_queue_status::file_closed){
+                // the file may be complete, an entry parked because it was not ready is tried once nothing writes to it for a moment.
+                // every close pushes the try back, a file appended to and closed over and over is copied once
+                bool parked{false};
+                {
+                    std::lock_guard<std::mutex> local_lock(m_state_mtx);
+                    auto wait = m_still_wait_data.find(source_path(entry));
+                    if(wait != m_still_wait_data.end() && !wait->second.retrying){
+                        wait->second.retry = now + std::chrono::milliseconds(MonitorCloseQuietPeriod);
+                        parked = true;
+                    }
+                }
+
+                if(pending != m_pending.end()){
+                    pending->second.entry.src_type = entry.src_type;
+                    pending->second.last = now;
+                    pending->second.closed = true;
+                }
+                else if(!parked){
+                    // written since it was last processed
+                    file_event updated = entry;
+                    updated.fqs = file_queue_status::file_updated;
+                    m_pending.emplace(std::move(key),pending_entry{std::move(updated),now,now,m_sequence++,true});
+                }
+                return;
+            }
+
+            if(pending == m_pending.end()){
+                // a removal without -sync does nothing
+                if(entry.fqs != file_queue_status::none){
+                    m_pending.emplace(std::move(key),pending_entry{entry,now,now,m_sequence++});
+                }
+            }
+            else if(!coalesce(pending->second.entry,entry)){
+                m_pending.erase(pending);
+            }
+            else{
+                // written again after it was closed
+                pending->second.last = now;
+                pending->second.closed = false;
+            }
+        }
+
+
+        // merges a new event into the pending event for the same path.
+        // added + updated is added, added + removed is nothing, updated + updated is one update and removed + added is added.
+        // returns false if the events cancel out and nothing is left to do
+        static bool coalesce(file_event& pending,const file_event& entry) noexcept{
+            switch(entry.fqs){
+                case file_queue_status::file_updated:{
+                    // an add or a removal stays what it is
+                    if(pending.fqs == file_queue_status::file_updated || pending.fqs == file_queue_status::file_added){
+                        pending.src_type = entry.src_type;
+                        return true;
+                    }
+                    pending = entry;
+                    return true;
+                }
+                case file_queue_status::file_removed:
+                case file_queue_status::none:{
+                    // the entry was created and removed before it was copied, unless it replaced one that is still at the destination
+                    bool at_destination = pending.dst_type != std::filesystem::file_type::none && 
+                                          pending.dst_type != std::filesystem::file_type::not_found;
+                    if(pending.fqs == file_queue_status::file_added && !at_destination){
+                        return false;
+                    }
+
+                    // without -sync the removal is not mirrored and the earlier event has nothing left to copy
+                    if(entry.fqs == file_queue_status::none){
+                        return false;
+                    }
+                    pending = entry;
+                    return true;
+                }
+                default:{
+                    pending = entry;
+                    return true;
+                }
+            }
+        }
+
+        // when the first pending entry becomes due, only called on the processor thread
+        std::chrono::steady_clock::time_point next_deadline() const noexcept{
+            auto deadline = std::chrono::steady_clock::time_point::max();
+            for(const auto& [key,pending]:m_pending){
+                deadline = std::min(deadline,due_time(pending));
+            }
+            return deadline;
+        }
+
+        static std::chrono::steady_clock::time_point due_time(const pending_entry& pending) noexcept{
+            // a closed file waits a shorter quiet period, a path that never goes quiet is still processed every MonitorMaxDelay
+            auto quiet = std::chrono::milliseconds(pending.closed ? MonitorCloseQuietPeriod : MonitorQuietPeriod);
+            return std::min(pending.last + quiet,pending.first + std::chrono::milliseconds(MonitorMaxDelay));
+        }
+
+        // moves the pending entries due by now to m_queue_buffer in the order their first events arrived, only called on the processor thread
+        void take_due_entries(std::chrono::steady_clock::time_point now){
+            std::vector<pending_entry> due;
+            for(auto pending = m_pending.begin();pending != m_pending.end();){
+                if(due_time(pending->second) <= now){
+                    due.push_back(std::move(pending->second));
+                    pending = m_pending.erase(pending);
+                }
+                else{
+                    pending++;
+                }
+            }
+
+            std::sort(due.begin(),due.end(),[](const pending_entry& a,const pending_entry& b){return a.order < b.order;});
+            for(auto& pending:due){
+                m_queue_buffer.emplace(std::move(pending.entry));
+            }
+        }
+
+        // the sync indexes of the -sync jobs, only used on the processor thread once process() started
+        std::unordered_map<std::uint32_t,std::unique_ptr<sync_index>> m_indexes;
+
+        // when the sync indexes were last saved
+        std::chrono::steady_clock::time_point m_index_saved{};
+
+        // compares every job that has a sync index with its source tree and queues the differences.
+        // without an index file the whole tree is compared with the destination and the index is built from it
+        void open_indexes() noexcept{
+            for(auto& [job,index]:m_indexes){
+                try{
+                    const copyto& dir = m_jobs[job];
+                    bool removals = (dir.commands & cs::sync) != cs::none;
+                    bool warm = index->load();
+                    if(warm){
+                        STDOUT << App_MESSAGE("Reconciling directory with its sync index: ") << dir.source << "\n";
+                    }
+                    else{
+                        STDOUT << App_MESSAGE("No sync index, comparing directory: ") << dir.source << App_MESSAGE(" to: ") << dir.destination << "\n";
+                    }
+
+                    std::uintmax_t queued{},checked{};
+                    std::uint64_t digest = index->digest();
+                    auto queue_event = [this,job,&queued](const std::filesystem::path::string_type& relative,file_queue_status fqs,
+                                                          std::filesystem::file_type src_type,std::filesystem::file_type dst_type){
+                        // the index already holds the state these events bring the destination to, they do not touch it
+                        ingest_entry(file_event{relative,job,fqs,src_type,dst_type},false);
+                        queued++;
+                    };
+
+                    index->reconcile([&](const std::filesystem::path& src,const std::filesystem::path::string_type& relative,file_queue_status fqs,std::filesystem::file_type type){
+                        std::filesystem::path dst = dir.destination/relative;
+                        std::error_code e;
+                        auto dst_type = std::filesystem::symlink_status(dst,e).type();
+
+                        if(fqs == file_queue_status::file_removed){
+                            if(removals){
+                                queue_event(relative,fqs,std::filesystem::file_type::not_found,dst_type);
+                            }
+                            return;
+                        }
+
+                        // without an index everything looks new, what is already at the destination and not older is left alone
+                        if(!warm && dst_type != std::filesystem::file_type::not_found && dst_type != std::filesystem::file_type::none){
+                            if(type != std::filesystem::file_type::regular){
+                                return;
+                            }
+
+                            std::error_code e_src,e_dst;
+                            auto t_src = std::filesystem::last_write_time(src,e_src);
+                            auto t_dst = std::filesystem::last_write_time(dst,e_dst);
+                            if(e_src || e_dst || t_src <= t_dst){
+                                return;
+                            }
+                            fqs = file_queue_status::file_updated;
+                        }
+
+                        queue_event(relative,fqs,type,dst_type);
+                    },[this,&checked]{
+                        // keep the ring drained while a large tree is checked
+                        if(++checked % SyncIndexIngestInterval == 0){
+                            ingest();
+                        }
+                    });
+
+                    // without an index nothing is known about what was removed from src, anything in dst that src does not have is
+                    if(!warm && removals && sfct_api::exists(dir.destination)){
+                        for(auto entry = std::filesystem::recursive_directory_iterator(dir.destination,std::filesystem::directory_options::skip_permission_denied);
+                            entry != std::filesystem::recursive_directory_iterator(); entry++){
+                            auto relative = entry->path().lexically_relative(dir.destination).native();
+                            if(!index->contains(relative)){
+                                std::error_code e;
+                                queue_event(relative,file_queue_status::file_removed,std::filesystem::file_type::not_found,entry->symlink_status(e).type());
+
+                                // removing a directory removes everything below it
+                                entry.disable_recursion_pending();
+                            }
+                            else if(!sfct_api::recursive_flag_check(dir.commands)){
+                                entry.disable_recursion_pending();
+                            }
+                        }
+                    }
+
+                    if(warm && index->digest() == digest){
+                        STDOUT << App_MESSAGE("Source unchanged since the last sync: ") << dir.source << "\n";
+                    }
+                    STDOUT << App_MESSAGE("Entries in the sync index: ") << index->size() << App_MESSAGE(" differences queued: ") << queued << "\n";
+                }
+                catch (const std::filesystem::filesystem_error& e) {
+                    // Handle filesystem related errors
+                    std::cerr << "Filesystem error: " << e.what() << "\n";
+                }
+                catch(const std::runtime_error& e){
+                    // the error message
+                    std::cerr << "Runtime error :" << e.what() << "\n";
+                }
+                catch(const std::bad_alloc& e){
+                    // the error message
+                    std::cerr << "Allocation error: " << e.what() << "\n";
+                }
+                catch (const std::exception& e) {
+                    // Catch other standard exceptions
+                    std::cerr << "Standard exception: " << e.what() << "\n";
+                } catch (...) {
+                    // Catch any other exceptions
+                    std::cerr << "Unknown exception caught \n";
+                }
+            }
+        }
+
+        // true if every event is processed and no entry waits to be tried again
+        bool idle(){
+            if(!m_ring.empty() || !m_pending.empty() || !m_queue_buffer.empty() || !m_wait_data.empty()){
+                return false;
+            }
+
+            std::lock_guard<std::mutex> local_lock(m_state_mtx);
+            return m_still_wait_data.empty();
+        }
+
+        // when the sync indexes have to be saved next, the processor is woken up by new events before that if it is not idle
+        std::chrono::steady_clock::time_point next_index_save(){
+            if(m_indexes.empty() || !idle()){
+                return std::chrono::steady_clock::time_point::max();
+            }
+
+            for(const auto& [job,index]:m_indexes){
+                if(index->unsaved() || index->touched()){
+                    return m_index_saved + std::chrono::milliseconds(SyncIndexSaveInterval);
+                }
+            }
+            return std::chrono::steady_clock::time_point::max();
+        }
+
+        // the source paths process_entry() copied since the indexes were last saved and whether the copy succeeded, guarded by m_state_mtx
+        std::vector<std::pair<std::filesystem::path,bool>> m_copy_results;
+
+        // copies the entry, the result is kept for the sync index of its job.
+        // the job commands carry -delta, -verify and -nocache to the copy, every copy process_entry() makes goes through here
+        void copy_entry(const file_queue_info& entry){
+            std::uintmax_t failures = sfct_api::get_thread_copy_failures();
+            sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
+            bool copied = sfct_api::get_thread_copy_failures() == failures;
+
+            if(!m_indexes.empty()){
+                std::lock_guard<std::mutex> local_lock(m_state_mtx);
+                m_copy_results.emplace_back(entry.src,copied);
+            }
+        }
+
+        // tells the sync indexes which entries could not be copied, they are left out until a later copy succeeds
+        void apply_copy_results(){
+            std::vector<std::pair<std::filesystem::path,bool>> results;
+            {
+                std::lock_guard<std::mutex> local_lock(m_state_mtx);
+                results.swap(m_copy_results);
+            }
+
+            for(const auto& [src,copied]:results){
+                for(auto& [job,index]:m_indexes){
+                    const std::filesystem::path& source = m_jobs[job].source;
+                    if(src == source || !same_subtree(source,src)){
+                        continue;
+                    }
+
+                    auto relative = src.lexically_relative(source).native();
+                    if(copied){
+                        index->copied(relative);
+                    }
+                    else{
+                        index->failed(relative);
+                    }
+                }
+            }
+        }
+
+        // the indexes are only refreshed and written once everything queued is processed, so a saved index always holds
+        // a state the destination was in sync with. They are written at most every SyncIndexSaveInterval, or now if stopping.
+        // when stopping the source is not read again, events for its latest changes may still be in the kernel's queue
+        // and are never processed, the index keeps the state of the last refresh
+        void save_indexes(bool stopping){
+            if(m_indexes.empty() || !idle()){
+                return;
+            }
+
+            apply_copy_results();
+            if(!stopping){
+                for(auto& [job,index]:m_indexes){
+                    index->refresh();
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if(!stopping && now < m_index_saved + std::chrono::milliseconds(SyncIndexSaveInterval)){
+                return;
+            }
+
+            for(auto& [job,index]:m_indexes){
+                if(index->unsaved()){
+                    index->save();
+                }
+            }
+            m_index_saved = now;
+        }
 
         std::vector<file_queue_info> m_new_main_directory_entries;
-        std::unordered_set<file_queue_info> m_all_seen_entries,m_all_seen_main_directory_entries;
+        // destination paths already processed, and the top level directories check() walked
+        path_trie m_all_seen_entries,m_all_seen_main_directory_entries;
 
         // we only check once
         void check() noexcept{
@@ -248,7 +1000,7 @@ namespace application{
                 bool exit__{false};
                 for(auto entry{m_new_main_directory_entries.begin()};entry != m_new_main_directory_entries.end() && !exit__;entry++){
                     if(sfct_api::exists(entry->src)){
-                        for(const auto& _entry:std::filesystem::recursive_directory_iterator(entry->src)){
+                        sfct_api::walk_directory(entry->src,true,[this,&entry](const std::filesystem::directory_entry& _entry){
                             auto dst_path = sfct_api::create_file_relative_path(_entry.path(),entry->dst,entry->src,false);
                             if(dst_path.has_value()){
                                 file_queue_info _file_info;
@@ -257,14 +1009,14 @@ namespace application{
                                 _file_info.dst = dst_path.value();
                                 _file_info.fqs = file_queue_status::file_added;
                                 _file_info.fs_dst = std::filesystem::status(dst_path.value());
-                                _file_info.fs_src = std::filesystem::status(_entry.path());
+                                _file_info.fs_src = sfct_api::get_entry_status(_entry);
                                 _file_info.main_dst = entry->main_dst;
                                 _file_info.main_src = entry->main_src;
                                 _file_info.src = _entry.path();
 
                                 // true if not in the set
                                 // false if in the set
-                                if(m_all_seen_entries.insert(_file_info).second){
+                                if(m_all_seen_entries.insert(_file_info.dst)){
                                     process_entry(_file_info);
                                 }
                                 else{
@@ -274,7 +1026,7 @@ namespace application{
                                     // exit__ = true;
                                 }
                             }
-                        }
+                        });
                     }
                     
                     
@@ -319,11 +1071,11 @@ namespace application{
                             // skip for now
                             break;
                         case std::filesystem::file_type::regular:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
@@ -331,59 +1083,62 @@ namespace application{
                         case std::filesystem::file_type::directory:{
                             if(sfct_api::exists(entry.src)){
                                 sfct_api::create_directory_paths(entry.dst);
-                                if(entry.src.parent_path() == entry.main_src && sfct_api::recursive_flag_check(entry.commands) && m_all_seen_main_directory_entries.insert(entry).second){
-                                    m_new_main_directory_entries.push_back(entry);
+                                if(entry.src.parent_path() == entry.main_src && sfct_api::recursive_flag_check(entry.commands)){
+                                    std::lock_guard<std::mutex> local_lock(m_state_mtx);
+                                    if(m_all_seen_main_directory_entries.insert(entry.dst)){
+                                        m_new_main_directory_entries.push_back(entry);
+                                    }
                                 }
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::symlink:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::block:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::character:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::fifo:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::socket:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
@@ -406,11 +1161,11 @@ namespace application{
                             // skip for now
                             break;
                         case std::filesystem::file_type::regular:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             break;
                         }
@@ -418,51 +1173,51 @@ namespace application{
                             
                             break;
                         case std::filesystem::file_type::symlink:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::block:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::character:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::fifo:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
                         }
                         case std::filesystem::file_type::socket:{
-                            if(sfct_api::entry_check(entry.src)){
-                                sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                            if(sfct_api::entry_check(entry.src,entry.fs_src)){
+                                copy_entry(entry);
                             }
                             else{
-                                m_still_wait_data.emplace(entry);
+                                wait_later(entry);
                             }
                             
                             break;
@@ -486,37 +1241,42 @@ namespace application{
                             break;
                         case std::filesystem::file_type::regular:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::directory:{
-                            m_all_seen_entries.clear();
+                            {
+                                // only what was below the directory is forgotten, a main directory created again is walked again
+                                std::lock_guard<std::mutex> local_lock(m_state_mtx);
+                                m_all_seen_entries.erase_subtree(entry.dst);
+                                m_all_seen_main_directory_entries.erase_subtree(entry.dst);
+                            }
                             sfct_api::remove_all(entry.dst);
                             break;
                         }
                         case std::filesystem::file_type::symlink:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::block:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::character:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::fifo:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::socket:{
                             sfct_api::remove_entry(entry.dst);
-                            m_all_seen_entries.erase(entry);
+                            forget_entry(entry);
                             break;
                         }
                         case std::filesystem::file_type::unknown:
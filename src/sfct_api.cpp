@@ -17,6 +17,11 @@ bool sfct_api::entry_check(path entry) noexcept
     return ext::entry_check(entry);
 }
 
+bool sfct_api::entry_check(path entry,const fs::file_status& s) noexcept
+{
+    return ext::entry_check(entry,s);
+}
+
 bool sfct_api::create_directory_paths(path src) noexcept
 {
     if(ext::exists(src)){
@@ -179,9 +184,9 @@ bool sfct_api::create_directory_tree(path src, path dst) noexcept
 
         // this may need to be further optimized in the future
         // create_relative_path is not a slow function but many calls add up depending on src directory size
-        for(const auto& entry: fs::recursive_directory_iterator(src)){
+        ext::walk_directory(src,true,[&src,&dst](const fs::directory_entry& entry){
             ext::create_relative_path(entry.path(),dst,src,true);
-        }
+        });
 
         // function may succeed but it could be the case that some or all directories failed to be created
         // the errors will be in the log file or console
@@ -228,13 +233,13 @@ std::optional<double_t> sfct_api::file_get_transfer_rate(path src) noexcept
     return ext::file_get_transfer_rate(src);
 }
 
-bool sfct_api::copy_file(path src, path dst, fs::copy_options co) noexcept
+bool sfct_api::copy_file(path src, path dst, fs::copy_options co,application::cs commands) noexcept
 {
     if(!ext::is_regular_file(src)){
         return false;
     }
 
-    return ext::copy_file(src,dst,co);
+    return ext::copy_file(src,dst,co,commands);
 }
 
 bool sfct_api::copy_file_create_path(path src, path dst, fs::copy_options co) noexcept
@@ -317,13 +322,13 @@ bool sfct_api::recursive_flag_check(application::cs commands) noexcept
     return ((commands & application::cs::recursive) != application::cs::none);
 }
 
-void sfct_api::copy_entry(path src, path dst, fs::copy_options co,bool create_dst) noexcept
+void sfct_api::copy_entry(path src, path dst, fs::copy_options co,bool create_dst,application::cs commands) noexcept
 {
     if(create_dst){
         ext::create_directory_paths(dst);
     }
     
-    return ext::copy_entry(src,dst,co);
+    return ext::copy_entry(src,dst,co,commands);
 }
 
 std::optional<std::shared_ptr<std::unordered_map<sfct_api::fs::path,sfct_api::fs::path>>> sfct_api::are_directories_synced(path src, path dst, bool recursive_sync) noexcept
@@ -376,6 +381,25 @@ std::optional<std::shared_ptr<std::unordered_map<sfct_api::fs::path,sfct_api::fs
 	}
 }
 
+bool sfct_api::diff_directories(path src,path dst,bool recursive,const std::function<void(const application::directory_diff&)>& fn) noexcept
+{
+    if(!ext::is_directory(src)){
+        application::logger log(App_MESSAGE("invalid directory"),application::Error::WARNING,src);
+        log.to_console();
+        log.to_log_file();
+        return false;
+    }
+
+    if(!ext::is_directory(dst)){
+        application::logger log(App_MESSAGE("invalid directory"),application::Error::WARNING,dst);
+        log.to_console();
+        log.to_log_file();
+        return false;
+    }
+
+    return ext::diff_directories(src,dst,recursive,fn);
+}
+
 std::optional<application::directory_info> sfct_api::get_directory_info(const application::copyto &dir) noexcept
 {
     if(!ext::is_directory(dir.source)){
@@ -437,10 +461,13 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     // skip for now
                     break;
                 case std::filesystem::file_type::regular:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    // the status is already known and dst is the destination file path, skip the checks copy_entry() makes
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        ext::copy_file(entry.src,entry.dst,entry.co,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -477,10 +504,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::symlink:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -510,10 +539,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::block:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -543,10 +574,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::character:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -576,10 +609,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::fifo:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -609,10 +644,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::socket:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -659,10 +696,13 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     // skip for now
                     break;
                 case std::filesystem::file_type::regular:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    // the status is already known and dst is the destination file path, skip the checks copy_entry() makes
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        ext::copy_file(entry.src,entry.dst,entry.co,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -694,10 +734,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     // skip
                     break;
                 case std::filesystem::file_type::symlink:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -727,10 +769,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::block:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -760,10 +804,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::character:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -793,10 +839,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::fifo:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -826,10 +874,12 @@ void sfct_api::process_file_queue_info_entry(const application::file_queue_info
                     break;
                 }
                 case std::filesystem::file_type::socket:{
-                    if(sfct_api::entry_check(entry.src)){
-                        sfct_api::copy_entry(entry.src,entry.dst,entry.co);
+                    if(ext::entry_check(entry.src,entry.fs_src)){
+                        sfct_api::copy_entry(entry.src,entry.dst,entry.co,false,entry.commands);
                     }
                     else{
+                        // the file is not copied, the job counts it as failed
+                        ext::count_copy_failure();
                         try{
                             application::logger log(App_MESSAGE("Skipping, File is in use: "),application::Error::INFO,entry.src);
                             log.to_console();
@@ -954,6 +1004,111 @@ void sfct_api::mt_process_file_queue_info_entry(application::file_queue_info ent
     return process_file_queue_info_entry(entry);
 }
 
+std::uintmax_t sfct_api::get_copy_strategy_count(application::copy_strategy strategy) noexcept
+{
+    return ext::get_copy_strategy_count(strategy);
+}
+
+bool sfct_api::walk_directory(path dir,bool recursive,const std::function<void(const fs::directory_entry&)>& consumer,fs::directory_options options) noexcept
+{
+    if(!ext::is_directory(dir)){
+        return false;
+    }
+
+    ext::walk_directory(dir,recursive,consumer,options);
+    return true;
+}
+
+sfct_api::fs::file_status sfct_api::get_entry_status(const fs::directory_entry& entry) noexcept
+{
+    return ext::entry_status(entry);
+}
+
+std::optional<sfct_api::fs::path> sfct_api::create_entry_relative_path(path src,const fs::file_status& s,path dst,path src_base) noexcept
+{
+    return ext::create_entry_relative_path(src,s,dst,src_base);
+}
+
+std::uintmax_t sfct_api::get_metadata_call_count() noexcept
+{
+    return ext::get_metadata_call_count();
+}
+
+std::uintmax_t sfct_api::get_sparse_bytes_skipped() noexcept
+{
+    return ext::get_sparse_bytes_skipped();
+}
+
+std::uintmax_t sfct_api::get_delta_bytes() noexcept
+{
+    return ext::get_delta_bytes();
+}
+
+std::uintmax_t sfct_api::get_delta_bytes_written() noexcept
+{
+    return ext::get_delta_bytes_written();
+}
+
+std::uintmax_t sfct_api::get_verified_bytes() noexcept
+{
+    return ext::get_verified_bytes();
+}
+
+std::uintmax_t sfct_api::get_verify_failures() noexcept
+{
+    return ext::get_verify_failures();
+}
+
+std::uintmax_t sfct_api::get_copy_failures() noexcept
+{
+    return ext::get_copy_failures();
+}
+
+std::uintmax_t sfct_api::get_thread_copy_failures() noexcept
+{
+    return ext::get_thread_copy_failures();
+}
+
+std::optional<std::uintmax_t> sfct_api::get_page_cache_size() noexcept
+{
+    return ext::get_page_cache_size();
+}
+
+application::buffer_pool::lease sfct_api::lease_buffer(std::size_t size) noexcept
+{
+    return ext::lease_buffer(size);
+}
+
+void sfct_api::return_buffer(application::buffer_pool::lease& buffer) noexcept
+{
+    ext::return_buffer(buffer);
+}
+
+std::vector<application::file_throughput> sfct_api::take_file_throughput() noexcept
+{
+    return ext::take_file_throughput();
+}
+
+bool sfct_api::uring_copy_file(path src,path dst,fs::copy_options co,application::cs commands) noexcept
+{
+    return ext::uring_copy_file(src,dst,co,commands);
+}
+
+void sfct_api::uring_wait() noexcept
+{
+    ext::uring_wait();
+}
+
+bool sfct_api::batch_small_files(application::cs commands) noexcept
+{
+    return ext::batch_small_files(commands);
+}
+
+std::vector<application::file_queue_info> sfct_api::copy_file_batch(const std::vector<application::file_queue_info>& batch) noexcept
+{
+    return ext::copy_file_batch(batch);
+}
+
 void sfct_api::to_console(const STRING& message,path p) noexcept
 {
     STDOUT << message << p << "\n";
@@ -1305,6 +1460,7 @@ std::optional<application::path_ext> sfct_api::ext::private_current_path() noexc
 application::file_status_ext sfct_api::ext::private_file_status(path entry) noexcept
 {
     application::file_status_ext _fs;
+    m_metadata_calls++;
     _fs.s = fs::status(entry,_fs.e);
     return _fs;
 }
@@ -1312,6 +1468,7 @@ application::file_status_ext sfct_api::ext::private_file_status(path entry) noex
 application::last_write_ext sfct_api::ext::private_last_write_time(path entry) noexcept
 {
     application::last_write_ext _lw;
+    m_metadata_calls++;
     _lw.t = fs::last_write_time(entry,_lw.e);
     return _lw;
 }
@@ -1319,6 +1476,7 @@ application::last_write_ext sfct_api::ext::private_last_write_time(path entry) n
 application::is_entry_ext sfct_api::ext::private_is_symlink(path entry) noexcept
 {
     application::is_entry_ext _is;
+    m_metadata_calls++;
     _is.rv = fs::is_symlink(entry,_is.e);
     return _is;
 }
@@ -1326,6 +1484,7 @@ application::is_entry_ext sfct_api::ext::private_is_symlink(path entry) noexcept
 application::is_entry_ext sfct_api::ext::private_is_regular_file(path entry) noexcept
 {
     application::is_entry_ext _is;
+    m_metadata_calls++;
     _is.rv = fs::is_regular_file(entry,_is.e);
     return _is;
 }
@@ -1333,6 +1492,7 @@ application::is_entry_ext sfct_api::ext::private_is_regular_file(path entry) noe
 application::is_entry_ext sfct_api::ext::private_exists(path entry) noexcept
 {
     application::is_entry_ext _is;
+    m_metadata_calls++;
     _is.rv = fs::exists(entry,_is.e);
     return _is;
 }
@@ -1340,6 +1500,7 @@ application::is_entry_ext sfct_api::ext::private_exists(path entry) noexcept
 application::is_entry_ext sfct_api::ext::private_is_directory(path entry) noexcept
 {
     application::is_entry_ext _is;
+    m_metadata_calls++;
     _is.rv = fs::is_directory(entry,_is.e);
     return _is;
 }
@@ -1433,17 +1594,14 @@ std::optional<std::uintmax_t> sfct_api::ext::get_file_size(path entry) noexcept
 	}
 }
 
-bool sfct_api::ext::copy_file(path src, path dst, fs::copy_options co) noexcept
+bool sfct_api::ext::copy_file(path src, path dst, fs::copy_options co,application::cs commands) noexcept
 {
     try{
-		application::copy_file_ext _cfe = private_copy_file(src,dst,co);
-        if(_cfe.e){
-            application::logger log(_cfe.e,application::Error::WARNING,src);
-            log.to_console();
-            log.to_log_file();
-            return false;
-        }
-        return true;
+		auto start = std::chrono::steady_clock::now();
+        application::copy_file_ext _cfe = private_copy_file(src,dst,co,commands);
+        std::chrono::duration<double_t> elapsed = std::chrono::steady_clock::now() - start;
+
+        return private_copy_done(src,_cfe,elapsed.count());
 	}
 	catch (const std::filesystem::filesystem_error& e) {
 		// Handle filesystem related errors
@@ -1532,6 +1690,7 @@ std::optional<bool> sfct_api::ext::create_directory_paths(path dir) noexcept
 {
     try{
 		std::error_code e;
+        m_metadata_calls++;
         if(fs::create_directories(dir,e)){
             return true;
         }
@@ -1741,48 +1900,55 @@ bool sfct_api::ext::is_entry_available(path entry) noexcept
 {
     auto fs = ext::file_status(entry);
     if(fs.has_value()){
-        switch(fs.value().type()){
-            case std::filesystem::file_type::none:
-                // skip for now
-                break;
-            case std::filesystem::file_type::not_found:
-                // skip for now
-                break;
-            case std::filesystem::file_type::regular:
-                return ext::private_open_file(entry);
-                break;
-            case std::filesystem::file_type::directory:
-                // do nothing
-                break;
-            case std::filesystem::file_type::symlink:{
-                auto target = ext::read_symlink(entry);
-                if(target.has_value()){
-                    return ext::private_open_file(target.value());
-                }
-                else{
-                    return false;
-                }
-                break;
-            } 
-            case std::filesystem::file_type::block:
-                return ext::private_open_file(entry);
-                break;
-            case std::filesystem::file_type::character:
-                return ext::private_open_file(entry);
-                break;
-            case std::filesystem::file_type::fifo:
-                return ext::private_open_file(entry);
-                break;
-            case std::filesystem::file_type::socket:
-                return ext::private_open_file(entry);
-                break;
-            case std::filesystem::file_type::unknown:
-                // skip
-                break;
-            default:
-                // do nothing
-                break;
-        }
+        return ext::is_entry_available(entry,fs.value());
+    }
+
+    return false;
+}
+
+bool sfct_api::ext::is_entry_available(path entry,const fs::file_status& s) noexcept
+{
+    switch(s.type()){
+        case std::filesystem::file_type::none:
+            // skip for now
+            break;
+        case std::filesystem::file_type::not_found:
+            // skip for now
+            break;
+        case std::filesystem::file_type::regular:
+            return ext::private_open_file(entry);
+            break;
+        case std::filesystem::file_type::directory:
+            // do nothing
+            break;
+        case std::filesystem::file_type::symlink:{
+            auto target = ext::read_symlink(entry);
+            if(target.has_value()){
+                return ext::private_open_file(target.value());
+            }
+            else{
+                return false;
+            }
+            break;
+        } 
+        case std::filesystem::file_type::block:
+            return ext::private_open_file(entry);
+            break;
+        case std::filesystem::file_type::character:
+            return ext::private_open_file(entry);
+            break;
+        case std::filesystem::file_type::fifo:
+            return ext::private_open_file(entry);
+            break;
+        case std::filesystem::file_type::socket:
+            return ext::private_open_file(entry);
+            break;
+        case std::filesystem::file_type::unknown:
+            // skip
+            break;
+        default:
+            // do nothing
+            break;
     }
 
     return false;
@@ -1841,12 +2007,154 @@ bool sfct_api::ext::is_entry_in_transit(path entry) noexcept
 	}
 }
 
-void sfct_api::ext::copy_entry(path src, path dst, fs::copy_options co) noexcept
+void sfct_api::ext::copy_entry(path src, path dst, fs::copy_options co,application::cs commands) noexcept
 {
     try{
 		std::error_code e;
+
+#if LINUX_BUILD
+        // send regular files through ext::copy_file() so the linux copy engine is used, 
+        // the directory rules are the same as std::filesystem::copy()
+        m_metadata_calls++;
+        fs::file_status s = fs::status(src,e);
+        if(fs::is_regular_file(s)){
+            // a missing dst is the normal case here, it is not an error worth logging
+            std::error_code dst_e;
+            m_metadata_calls++;
+            ext::copy_file(src,fs::is_directory(dst,dst_e) ? dst/src.filename() : dst,co,commands);
+            return;
+        }
+
+        bool recursive = (co & fs::copy_options::recursive) != fs::copy_options::none;
+        if(fs::is_directory(s) && (recursive || co == fs::copy_options::none)){
+            fs::create_directories(dst,e);
+            if(e){
+                count_copy_failure();
+                ext::log_error_code(e,dst);
+                return;
+            }
+
+            // regular files are copied in batches of SmallFileBatchSize by the TM workers. a caller that is a TM worker
+            // itself can not wait for other tasks, it copies its batches on its own thread
+            application::TM& worker = application::TM::shared();
+            bool batching = ext::batch_small_files(commands);
+            bool parallel = batching && !worker.on_worker();
+            std::vector<application::file_queue_info> batch;
+            std::deque<std::future<std::vector<application::file_queue_info>>> batches;
+            std::vector<std::future<bool>> files;
+
+            // the files a batch hands back are too large for it, each one is copied on its own
+            auto copy_rest = [&worker,&files,parallel](const std::vector<application::file_queue_info>& rest){
+                for(const auto& entry:rest){
+                    if(parallel){
+                        files.push_back(worker.submit(&ext::copy_file,entry.src,entry.dst,entry.co,entry.commands));
+                    }
+                    else{
+                        ext::copy_file(entry.src,entry.dst,entry.co,entry.commands);
+                    }
+                }
+            };
+
+            auto copy_batch = [&worker,&batch,&batches,&copy_rest,parallel](){
+                if(batch.empty()){
+                    return;
+                }
+
+                if(parallel){
+                    batches.push_back(worker.submit(&ext::copy_file_batch,batch));
+                    worker.join_one();
+                }
+                else{
+                    copy_rest(ext::copy_file_batch(batch));
+                }
+                batch.clear();
+
+                // batches that are done hand over their large files while the tree is still being read
+                while(!batches.empty() && batches.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+                    copy_rest(batches.front().get());
+                    batches.pop_front();
+                }
+            };
+
+            auto copy_dir_entry = [&src,&dst,co,commands,batching,&batch,&copy_batch](const fs::directory_entry& entry){
+                std::error_code e;
+                fs::path target = dst/entry.path().lexically_relative(src);
+                if(entry.is_directory(e)){
+                    fs::create_directory(target,e);
+                }
+                else if(entry.is_regular_file(e)){
+                    // -uring queues the file and only copies it here if io_uring is not available
+                    if((commands & application::cs::uring) != application::cs::none && ext::uring_copy_file(entry.path(),target,co,commands)){
+                        return;
+                    }
+
+                    if(batching){
+                        application::file_queue_info _file_info;
+                        _file_info.co = co;
+                        _file_info.commands = commands;
+                        _file_info.dst = target;
+                        _file_info.fqs = application::file_queue_status::file_added;
+                        _file_info.src = entry.path();
+                        batch.push_back(_file_info);
+
+                        if(batch.size() >= SmallFileBatchSize){
+                            copy_batch();
+                        }
+                    }
+                    else{
+                        ext::copy_file(entry.path(),target,co,commands);
+                    }
+                    return;
+                }
+                else{
+                    fs::copy(entry.path(),target,co,e);
+                }
+
+                if(e){
+                    count_copy_failure();
+                    ext::log_error_code(e,entry.path());
+                }
+            };
+
+            // a directory that can not be read is logged and counted as a failure, the rest of the tree is still copied.
+            // a directory is created by copy_dir_entry() before it is read, symlinks to directories are not followed
+            std::vector<fs::path> directories{src};
+            while(!directories.empty()){
+                fs::path dir = std::move(directories.back());
+                directories.pop_back();
+
+                std::error_code e_dir;
+                for(fs::directory_iterator entry(dir,e_dir),end; !e_dir && entry != end; entry.increment(e_dir)){
+                    copy_dir_entry(*entry);
+
+                    std::error_code e_type;
+                    if(recursive && entry->is_directory(e_type) && !entry->is_symlink(e_type)){
+                        directories.push_back(entry->path());
+                    }
+                }
+
+                if(e_dir){
+                    count_copy_failure();
+                    ext::log_error_code(e_dir,dir);
+                }
+            }
+
+            copy_batch();
+            while(!batches.empty()){
+                copy_rest(batches.front().get());
+                batches.pop_front();
+            }
+            for(auto& file:files){
+                file.wait();
+            }
+            ext::uring_wait();
+            return;
+        }
+#endif
+
         fs::copy(src,dst,co,e);
         if(e){
+            count_copy_failure();
             application::logger log(e,application::Error::WARNING,src);
             log.to_console();
             log.to_log_file();
@@ -1855,77 +2163,50 @@ void sfct_api::ext::copy_entry(path src, path dst, fs::copy_options co) noexcept
 	catch (const std::filesystem::filesystem_error& e) {
 		// Handle filesystem related errors
 		std::cerr << "Filesystem error: " << e.what() << "\n";
+
+		count_copy_failure();
 	}
 	catch(const std::runtime_error& e){
 		// the error message
 		std::cerr << "Runtime error :" << e.what() << "\n";
+
+		count_copy_failure();
 	}
 	catch(const std::bad_alloc& e){
 		// the error message
 		std::cerr << "Allocation error: " << e.what() << "\n";
+
+		count_copy_failure();
 	}
 	catch (const std::exception& e) {
 		// Catch other standard exceptions
 		std::cerr << "Standard exception: " << e.what() << "\n";
+
+		count_copy_failure();
 	} catch (...) {
 		// Catch any other exceptions
 		std::cerr << "Unknown exception caught \n";
+
+		count_copy_failure();
 	}
 }
 
 std::optional<std::shared_ptr<std::unordered_map<sfct_api::fs::path,sfct_api::fs::path>>> sfct_api::ext::are_directories_synced(path src, path dst,bool recursive_sync) noexcept
 {
     try{
-		std::unordered_map<fs::path,fs::path> paths_mp; // key is dst, value is src
-
-        if(recursive_sync){
-
-            for(const auto& entry:fs::recursive_directory_iterator(src)){
-                auto relative_path = ext::create_relative_path(entry.path(),dst,src,false);
-                if(relative_path.has_value()){
-                    paths_mp.emplace(relative_path.value(),entry.path());
-                }
-            }
-
-            for(const auto& entry:fs::recursive_directory_iterator(dst)){
-                auto found = paths_mp.find(entry.path());
-                if(found != paths_mp.end()){
-                    paths_mp.erase(found);
-                }
-            }
+        auto paths_mp = std::make_shared<std::unordered_map<fs::path,fs::path>>(); // key is dst, value is src
 
-            if(paths_mp.empty()){
-                return std::nullopt;
+        ext::diff_directories(src,dst,recursive_sync,[&paths_mp](const application::directory_diff& diff){
+            if(diff.status == application::diff_status::added){
+                paths_mp->emplace(diff.dst,diff.src);
             }
-            
-            return std::make_shared<std::unordered_map<fs::path,fs::path>>(paths_mp);
+        });
 
+        if(paths_mp->empty()){
+            return std::nullopt;
         }
-        else{
-
-            for(const auto& entry:fs::directory_iterator(src)){
-                fs::path entry_path = entry.path();
-                fs::path relative_path;
-                if(entry_path.has_filename()){
-                    relative_path = dst/entry_path.filename();
-                    paths_mp.emplace(relative_path,entry_path);
-                }
-            }
-
-            for(const auto& entry:fs::directory_iterator(dst)){
-                auto found = paths_mp.find(entry.path());
-                if(found != paths_mp.end()){
-                    paths_mp.erase(found);
-                }
-            }
-
-            if(paths_mp.empty()){
-                return std::nullopt;
-            }
-            
-            return std::make_shared<std::unordered_map<fs::path,fs::path>>(paths_mp);
 
-        }
+        return paths_mp;
 	}
 	catch (const std::filesystem::filesystem_error& e) {
 		// Handle filesystem related errors
@@ -1956,7 +2237,121 @@ std::optional<std::shared_ptr<std::unordered_map<sfct_api::fs::path,sfct_api::fs
 
 		return std::nullopt;
 	}
-    
+}
+
+bool sfct_api::ext::diff_directories(path src,path dst,bool recursive,const std::function<void(const application::directory_diff&)>& fn) noexcept
+{
+    try{
+        // one entry of the directory level being compared
+        struct level_entry{
+            fs::path::string_type name;
+            fs::file_type type;
+        };
+
+        // reads the names of a directory sorted, so both sides can be merged in one pass
+        auto read_level = [](const fs::path& dir,std::vector<level_entry>& entries){
+            entries.clear();
+            std::error_code e;
+            for(fs::directory_iterator entry(dir,fs::directory_options::skip_permission_denied,e),end; !e && entry != end; entry.increment(e)){
+                std::error_code e_type;
+                entries.push_back({entry->path().filename().native(),entry->symlink_status(e_type).type()});
+            }
+            std::sort(entries.begin(),entries.end(),[](const level_entry& a,const level_entry& b){return a.name < b.name;});
+            return !e;
+        };
+
+        // everything below an added directory is added too
+        auto report_added = [&fn,recursive](const fs::path& src_entry,const fs::path& dst_entry,fs::file_type type){
+            fn({src_entry,dst_entry,application::diff_status::added,type});
+            if(!recursive || type != fs::file_type::directory){
+                return;
+            }
+
+            std::error_code e;
+            for(fs::recursive_directory_iterator entry(src_entry,fs::directory_options::skip_permission_denied,e),end; !e && entry != end; entry.increment(e)){
+                std::error_code e_type;
+                fn({entry->path(),dst_entry/entry->path().lexically_relative(src_entry),application::diff_status::added,entry->symlink_status(e_type).type()});
+            }
+        };
+
+        // a regular file changed if the size differs or the source is newer, the same test -update uses
+        auto file_changed = [](const fs::path& src_entry,const fs::path& dst_entry){
+            std::error_code e_src,e_dst;
+            if(fs::file_size(src_entry,e_src) != fs::file_size(dst_entry,e_dst) || e_src || e_dst){
+                return true;
+            }
+            auto t_src = fs::last_write_time(src_entry,e_src);
+            auto t_dst = fs::last_write_time(dst_entry,e_dst);
+            return e_src || e_dst || t_src > t_dst;
+        };
+
+        // only the directories still to be compared and the two levels being merged are held
+        std::vector<std::pair<fs::path,fs::path>> directories{{src,dst}};
+        std::vector<level_entry> src_level,dst_level;
+        bool read_all{true};
+
+        while(!directories.empty()){
+            auto [src_dir,dst_dir] = std::move(directories.back());
+            directories.pop_back();
+
+            read_all &= read_level(src_dir,src_level);
+            read_all &= read_level(dst_dir,dst_level);
+
+            auto s = src_level.begin();
+            auto d = dst_level.begin();
+            while(s != src_level.end() || d != dst_level.end()){
+                if(d == dst_level.end() || (s != src_level.end() && s->name < d->name)){
+                    report_added(src_dir/s->name,dst_dir/s->name,s->type);
+                    s++;
+                }
+                else if(s == src_level.end() || d->name < s->name){
+                    // removing a directory removes everything below it, so it is reported once
+                    fn({src_dir/d->name,dst_dir/d->name,application::diff_status::removed,d->type});
+                    d++;
+                }
+                else{
+                    fs::path src_entry = src_dir/s->name;
+                    fs::path dst_entry = dst_dir/d->name;
+                    if(s->type != d->type){
+                        fn({src_entry,dst_entry,application::diff_status::changed,s->type});
+                    }
+                    else if(s->type == fs::file_type::directory){
+                        if(recursive){
+                            directories.push_back({std::move(src_entry),std::move(dst_entry)});
+                        }
+                    }
+                    else if(s->type == fs::file_type::regular && file_changed(src_entry,dst_entry)){
+                        fn({src_entry,dst_entry,application::diff_status::changed,s->type});
+                    }
+                    s++;
+                    d++;
+                }
+            }
+        }
+
+        return read_all;
+	}
+	catch (const std::filesystem::filesystem_error& e) {
+		// Handle filesystem related errors
+		std::cerr << "Filesystem error: " << e.what() << "\n";
+	}
+	catch(const std::runtime_error& e){
+		// the error message
+		std::cerr << "Runtime error :" << e.what() << "\n";
+	}
+	catch(const std::bad_alloc& e){
+		// the error message
+		std::cerr << "Allocation error: " << e.what() << "\n";
+	}
+	catch (const std::exception& e) {
+		// Catch other standard exceptions
+		std::cerr << "Standard exception: " << e.what() << "\n";
+	} catch (...) {
+		// Catch any other exceptions
+		std::cerr << "Unknown exception caught \n";
+	}
+
+    return false;
 }
 
 void sfct_api::ext::log_error_code(const std::error_code &e,path p) noexcept
@@ -1995,12 +2390,18 @@ application::directory_info sfct_api::ext::get_directory_info(const application:
 		if(sfct_api::recursive_flag_check(dir.commands)){
 
             application::directory_info di{};
-            for(const auto& entry:fs::recursive_directory_iterator(dir.source)){
-                std::error_code e;
-                di.TotalSize += entry.file_size(e);
-                ext::log_error_code(e,entry.path());
+            ext::walk_directory(dir.source,true,[&di](const fs::directory_entry& entry){
+                // only files have a size, file_size() returns -1 for anything else
+                if(ext::entry_status(entry).type() == fs::file_type::regular){
+                    std::error_code e;
+                    std::uintmax_t size = entry.file_size(e);
+                    if(!e){
+                        di.TotalSize += size;
+                    }
+                    ext::log_error_code(e,entry.path());
+                }
                 di.FileCount++;
-            }
+            });
 
             di.AvgFileSize = static_cast<double_t>(di.TotalSize / di.FileCount);
 
@@ -2011,9 +2412,15 @@ application::directory_info sfct_api::ext::get_directory_info(const application:
 
             application::directory_info di{};
             for(const auto& entry:fs::directory_iterator(dir.source)){
-                std::error_code e;
-                di.TotalSize += entry.file_size(e);
-                ext::log_error_code(e,entry.path());
+                // only files have a size, file_size() returns -1 for anything else
+                if(ext::entry_status(entry).type() == fs::file_type::regular){
+                    std::error_code e;
+                    std::uintmax_t size = entry.file_size(e);
+                    if(!e){
+                        di.TotalSize += size;
+                    }
+                    ext::log_error_code(e,entry.path());
+                }
                 di.FileCount++;
             }
 
@@ -2101,13 +2508,22 @@ std::optional<sfct_api::fs::path> sfct_api::ext::read_symlink(path src_link) noe
 
 bool sfct_api::ext::entry_check(path entry) noexcept
 {
-    if(!ext::is_entry_available(entry)){
-        while(ext::is_entry_in_transit(entry)){}
-    }
-    
+    // never waits for a writer, the caller tries again later
     return ext::is_entry_available(entry);
 }
 
+bool sfct_api::ext::entry_check(path entry,const fs::file_status& s) noexcept
+{
+#if LINUX_BUILD
+    // files are not locked on linux, opening it only to close it again would succeed and Linux::CopyFile() opens it anyway
+    if(fs::is_regular_file(s)){
+        return true;
+    }
+#endif
+
+    return ext::is_entry_available(entry,s);
+}
+
 void sfct_api::ext::rename_entry(path old_entry, path new_entry) noexcept
 {
     try{
@@ -2144,6 +2560,7 @@ std::optional<application::copy_sym_ext> sfct_api::ext::private_read_symlink(pat
 {
     try{
 		application::copy_sym_ext _cs;
+        m_metadata_calls++;
         _cs.target = fs::read_symlink(src_link,_cs.e);
         return _cs;
 	}
@@ -2182,6 +2599,7 @@ bool sfct_api::ext::private_open_file(path filepath) noexcept
 {
     try{
 		std::fstream file;
+        m_metadata_calls++;
         file.open(filepath, std::ifstream::in | std::ifstream::binary);
         if(file.is_open()){
             file.close();
@@ -2269,6 +2687,8 @@ std::optional<application::path_ext> sfct_api::ext::private_get_relative_path(pa
 {
     try{
 		application::path_ext _p;
+        // relative() makes both paths canonical so this is several syscalls, counted as one
+        m_metadata_calls++;
         _p.p = fs::relative(entry,base,_p.e);
         return _p;
 	}
@@ -2310,11 +2730,670 @@ application::file_size_ext sfct_api::ext::private_get_file_size(path entry) noex
     return _fse;
 }
 
-application::copy_file_ext sfct_api::ext::private_copy_file(path src, path dst, fs::copy_options co) noexcept
+application::copy_file_ext sfct_api::ext::private_copy_file(path src, path dst, fs::copy_options co,application::cs commands) noexcept
 {
+#if LINUX_BUILD
+    return Linux::CopyFile(src,dst,co,commands);
+#else
     application::copy_file_ext _cfe;
     _cfe.rv = fs::copy_file(src,dst,co,_cfe.e);
+    _cfe.strategy = application::copy_strategy::std_copy;
+
+    if(_cfe.rv && (commands & application::cs::verify) != application::cs::none){
+        private_verify_copy(src,dst,_cfe);
+    }
     return _cfe;
+#endif
 }
 
+void sfct_api::ext::private_verify_copy(path src,path dst,application::copy_file_ext& _cfe) noexcept
+{
+    try{
+        std::ifstream src_file(src,std::ios::binary),dst_file(dst,std::ios::binary);
+        if(!src_file.is_open() || !dst_file.is_open()){
+            _cfe.e = std::make_error_code(std::errc::io_error);
+            return;
+        }
+
+        // a window of each file at a time so a mismatch is found without reading the rest
+        application::buffer_pool::lease src_buffer = lease_buffer(CopyBufferSize);
+        application::buffer_pool::lease dst_buffer = lease_buffer(CopyBufferSize);
+        if(!src_buffer || !dst_buffer){
+            throw std::bad_alloc();
+        }
+        bool match = true;
+        while(match){
+            src_file.read(src_buffer.data(),static_cast<std::streamsize>(src_buffer.size()));
+            std::streamsize src_read = src_file.gcount();
+
+            dst_file.read(dst_buffer.data(),static_cast<std::streamsize>(dst_buffer.size()));
+            std::streamsize dst_read = dst_file.gcount();
 
+            match = src_read == dst_read && std::memcmp(src_buffer.data(),dst_buffer.data(),static_cast<std::size_t>(src_read)) == 0;
+            if(src_read == 0 || dst_read == 0){
+                break;
+            }
+        }
+
+        _cfe.verified = true;
+        _cfe.verify_mismatch = !match;
+        _cfe.bytes = get_file_size(src).value_or(0);
+        if(!match){
+            // a bad copy would look up to date to -update, remove it so the next run copies it again
+            std::error_code e;
+            fs::remove(dst,e);
+            _cfe.rv = false;
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error :" << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+std::uintmax_t sfct_api::ext::get_copy_strategy_count(application::copy_strategy strategy) noexcept
+{
+    return m_copy_strategy_count[static_cast<size_t>(strategy)].load();
+}
+
+struct sfct_api::ext::walk_state{
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // directories waiting to be scanned, used as a stack so the walk stays deep instead of wide
+    std::vector<fs::path> directories;
+
+    // entries waiting for the consumer, one batch per scanned directory
+    std::deque<std::vector<fs::directory_entry>> batches;
+
+    // directories queued or being scanned
+    std::size_t outstanding{};
+
+    // set when walk_directory() returns, queued scan tasks do nothing after that
+    bool stop{false};
+
+    bool recursive{true};
+    fs::directory_options options{fs::directory_options::none};
+};
+
+void sfct_api::ext::walk_directory(path dir,bool recursive,const std::function<void(const fs::directory_entry&)>& consumer,fs::directory_options options) noexcept
+{
+    // the scan tasks hold their own reference, one may still be queued on the pool after this function returns
+    std::shared_ptr<walk_state> state;
+
+    try{
+        state = std::make_shared<walk_state>();
+        state->recursive = recursive;
+        state->options = options;
+        state->directories.push_back(dir);
+        state->outstanding = 1;
+
+        std::unique_lock<std::mutex> local_lock(state->mtx);
+        while(true){
+            if(!state->batches.empty()){
+                std::vector<fs::directory_entry> batch = std::move(state->batches.front());
+                state->batches.pop_front();
+
+                local_lock.unlock();
+                for(const auto& entry:batch){
+                    consumer(entry);
+                }
+                local_lock.lock();
+                continue;
+            }
+
+            // nothing to consume, help scan instead of waiting on the workers
+            if(!state->directories.empty()){
+                fs::path next = std::move(state->directories.back());
+                state->directories.pop_back();
+
+                local_lock.unlock();
+                private_walk_scan(state,next);
+                local_lock.lock();
+                continue;
+            }
+
+            if(state->outstanding == 0){
+                break;
+            }
+
+            // another thread is scanning a directory
+            state->cv.wait(local_lock);
+        }
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error :" << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    // if the consumer threw, stop the scan tasks that are still queued
+    if(state){
+        std::lock_guard<std::mutex> local_lock(state->mtx);
+        state->stop = true;
+        state->directories.clear();
+        state->batches.clear();
+    }
+}
+
+void sfct_api::ext::private_walk_scan(const std::shared_ptr<walk_state>& state,const fs::path& dir) noexcept
+{
+    std::vector<fs::directory_entry> batch;
+    std::vector<fs::path> subdirectories;
+
+    try{
+        std::error_code e;
+        fs::directory_iterator it(dir,state->options,e);
+        for(;!e && it != fs::directory_iterator();it.increment(e)){
+            const fs::directory_entry& entry = *it;
+            batch.push_back(entry);
+
+            if(state->recursive){
+                // the entry type comes from the directory listing, no extra stat is needed for most filesystems
+                std::error_code type_e;
+                bool follow = (state->options & fs::directory_options::follow_directory_symlink) != fs::directory_options::none;
+                if(entry.is_directory(type_e) && (follow || !entry.is_symlink(type_e))){
+                    subdirectories.push_back(entry.path());
+                }
+            }
+        }
+        log_error_code(e,dir);
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error :" << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    std::size_t queued{};
+    {
+        std::lock_guard<std::mutex> local_lock(state->mtx);
+        try{
+            if(!state->stop){
+                // the batch goes in before the subdirectories are queued so a directory entry always
+                // reaches the consumer before the entries inside it
+                if(!batch.empty()){
+                    state->batches.push_back(std::move(batch));
+                }
+                for(auto& subdirectory:subdirectories){
+                    state->directories.push_back(std::move(subdirectory));
+                    state->outstanding++;
+                    queued++;
+                }
+            }
+        }
+        catch(const std::bad_alloc& e){
+            // the error message
+            std::cerr << "Allocation error: " << e.what() << "\n";
+        } catch (...) {
+            // Catch any other exceptions
+            std::cerr << "Unknown exception caught \n";
+        }
+
+        // this directory is done, always counted or walk_directory() would wait forever
+        state->outstanding--;
+    }
+    state->cv.notify_all();
+
+    // one task per subdirectory, the calling thread of walk_directory() may take some of them first
+    for(std::size_t i{};i<queued;i++){
+        application::TM::shared().do_work(&ext::private_walk_task,state);
+    }
+}
+
+void sfct_api::ext::private_walk_task(std::shared_ptr<walk_state> state) noexcept
+{
+    fs::path next;
+    {
+        std::lock_guard<std::mutex> local_lock(state->mtx);
+        if(state->stop || state->directories.empty()){
+            return;
+        }
+        next = std::move(state->directories.back());
+        state->directories.pop_back();
+    }
+
+    private_walk_scan(state,next);
+}
+
+sfct_api::fs::file_status sfct_api::ext::entry_status(const fs::directory_entry& entry) noexcept
+{
+    try{
+		std::error_code e;
+
+        // both use the type cached by the directory iterator, a syscall is only made when the type was not reported
+        if(entry.is_regular_file(e)){
+            return fs::file_status(fs::file_type::regular);
+        }
+        if(entry.is_directory(e)){
+            return fs::file_status(fs::file_type::directory);
+        }
+
+        // symlinks are followed like std::filesystem::status() and other types are rare enough to stat
+        m_metadata_calls++;
+        fs::file_status s = fs::status(entry.path(),e);
+        log_error_code(e,entry.path());
+        return s;
+	}
+	catch (const std::filesystem::filesystem_error& e) {
+		// Handle filesystem related errors
+		std::cerr << "Filesystem error: " << e.what() << "\n";
+
+		return fs::file_status{};
+	}
+	catch(const std::runtime_error& e){
+		// the error message
+		std::cerr << "Runtime error :" << e.what() << "\n";
+		
+		return fs::file_status{};
+	}
+	catch(const std::bad_alloc& e){
+		// the error message
+		std::cerr << "Allocation error: " << e.what() << "\n";
+
+		return fs::file_status{};
+	}
+	catch (const std::exception& e) {
+		// Catch other standard exceptions
+		std::cerr << "Standard exception: " << e.what() << "\n";
+
+		return fs::file_status{};
+	} catch (...) {
+		// Catch any other exceptions
+		std::cerr << "Unknown exception caught \n";
+
+		return fs::file_status{};
+	}
+}
+
+std::optional<sfct_api::fs::path> sfct_api::ext::create_entry_relative_path(path src,const fs::file_status& s,path dst,path src_base) noexcept
+{
+    try{
+		// walk_directory() builds every path by appending to src_base so the lexical path is the same as fs::relative()
+        fs::path relative_path = src.lexically_relative(src_base);
+        if(relative_path.empty() || *relative_path.begin() == ".."){
+            return std::nullopt;
+        }
+
+        fs::path file_dst = dst/relative_path;
+        if(fs::is_directory(s)){
+            std::error_code e;
+            m_metadata_calls++;
+            fs::create_directory(file_dst,e);
+            if(e){
+                log_error_code(e,file_dst);
+                return std::nullopt;
+            }
+        }
+
+        return file_dst;
+	}
+	catch (const std::filesystem::filesystem_error& e) {
+		// Handle filesystem related errors
+		std::cerr << "Filesystem error: " << e.what() << "\n";
+
+		return std::nullopt;
+	}
+	catch(const std::runtime_error& e){
+		// the error message
+		std::cerr << "Runtime error :" << e.what() << "\n";
+		
+		return std::nullopt;
+	}
+	catch(const std::bad_alloc& e){
+		// the error message
+		std::cerr << "Allocation error: " << e.what() << "\n";
+
+		return std::nullopt;
+	}
+	catch (const std::exception& e) {
+		// Catch other standard exceptions
+		std::cerr << "Standard exception: " << e.what() << "\n";
+
+		return std::nullopt;
+	} catch (...) {
+		// Catch any other exceptions
+		std::cerr << "Unknown exception caught \n";
+
+		return std::nullopt;
+	}
+}
+
+std::uintmax_t sfct_api::ext::get_metadata_call_count() noexcept
+{
+    return m_metadata_calls.load();
+}
+
+std::uintmax_t sfct_api::ext::get_sparse_bytes_skipped() noexcept
+{
+    return m_sparse_bytes.load();
+}
+
+std::uintmax_t sfct_api::ext::get_delta_bytes() noexcept
+{
+    return m_delta_bytes.load();
+}
+
+std::uintmax_t sfct_api::ext::get_delta_bytes_written() noexcept
+{
+    return m_delta_written.load();
+}
+
+std::uintmax_t sfct_api::ext::get_verified_bytes() noexcept
+{
+    return m_verified_bytes.load();
+}
+
+std::uintmax_t sfct_api::ext::get_verify_failures() noexcept
+{
+    return m_verify_failures.load();
+}
+
+std::uintmax_t sfct_api::ext::get_copy_failures() noexcept
+{
+    return m_copy_failures.load();
+}
+
+std::uintmax_t sfct_api::ext::get_thread_copy_failures() noexcept
+{
+    return t_copy_failures;
+}
+
+void sfct_api::ext::count_copy_failure() noexcept
+{
+    m_copy_failures++;
+    t_copy_failures++;
+}
+
+application::buffer_pool::lease sfct_api::ext::lease_buffer(std::size_t size) noexcept
+{
+    return application::buffer_pool::take_shared(size);
+}
+
+void sfct_api::ext::return_buffer(application::buffer_pool::lease& buffer) noexcept
+{
+    buffer.release();
+}
+
+std::optional<std::uintmax_t> sfct_api::ext::get_page_cache_size() noexcept
+{
+#if LINUX_BUILD
+    try{
+        // lines look like "Cached:          1319256 kB"
+        std::ifstream meminfo("/proc/meminfo");
+        std::string line;
+        while(std::getline(meminfo,line)){
+            if(line.rfind("Cached:",0) == 0){
+                return std::stoull(line.substr(7)) * 1024;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        // Catch standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+#endif
+    return std::nullopt;
+}
+
+std::vector<application::file_throughput> sfct_api::ext::take_file_throughput() noexcept
+{
+    try{
+		std::lock_guard<std::mutex> local_lock(m_throughput_mtx);
+        std::vector<application::file_throughput> results;
+        results.swap(m_throughput);
+        return results;
+	}
+	catch (const std::filesystem::filesystem_error& e) {
+		// Handle filesystem related errors
+		std::cerr << "Filesystem error: " << e.what() << "\n";
+
+		return {};
+	}
+	catch(const std::runtime_error& e){
+		// the error message
+		std::cerr << "Runtime error :" << e.what() << "\n";
+		
+		return {};
+	}
+	catch(const std::bad_alloc& e){
+		// the error message
+		std::cerr << "Allocation error: " << e.what() << "\n";
+
+		return {};
+	}
+	catch (const std::exception& e) {
+		// Catch other standard exceptions
+		std::cerr << "Standard exception: " << e.what() << "\n";
+
+		return {};
+	} catch (...) {
+		// Catch any other exceptions
+		std::cerr << "Unknown exception caught \n";
+
+		return {};
+	}
+}
+
+bool sfct_api::ext::private_copy_done(path src,const application::copy_file_ext& _cfe,double_t seconds) noexcept
+{
+    try{
+		m_metadata_calls += _cfe.metadata_calls;
+        if(_cfe.e){
+            count_copy_failure();
+            application::logger log(_cfe.e,application::Error::WARNING,src);
+            log.to_console();
+            log.to_log_file();
+            return false;
+        }
+
+        if(_cfe.verify_mismatch){
+            count_copy_failure();
+            m_verify_failures++;
+            application::logger log(App_MESSAGE("Verification failed, the copy did not match the source and was removed"),application::Error::WARNING,src);
+            log.to_console();
+            log.to_log_file();
+            return false;
+        }
+
+        if(_cfe.verified){
+            m_verified_bytes += _cfe.bytes;
+        }
+
+        if(_cfe.rv){
+            m_copy_strategy_count[static_cast<size_t>(_cfe.strategy)]++;
+            m_sparse_bytes += _cfe.sparse_bytes;
+            if(_cfe.strategy == application::copy_strategy::delta){
+                m_delta_bytes += _cfe.bytes;
+                m_delta_written += _cfe.delta_written;
+            }
+
+            // only large files are kept, a record for every file would grow without limit on big trees
+            if(_cfe.bytes >= ThroughputReportSize){
+                std::lock_guard<std::mutex> local_lock(m_throughput_mtx);
+                m_throughput.push_back({src,_cfe.bytes,seconds,_cfe.strategy});
+            }
+        }
+        return true;
+	}
+	catch (const std::filesystem::filesystem_error& e) {
+		// Handle filesystem related errors
+		std::cerr << "Filesystem error: " << e.what() << "\n";
+
+		return false;
+	}
+	catch(const std::runtime_error& e){
+		// the error message
+		std::cerr << "Runtime error :" << e.what() << "\n";
+		
+		return false;
+	}
+	catch(const std::bad_alloc& e){
+		// the error message
+		std::cerr << "Allocation error: " << e.what() << "\n";
+
+		return false;
+	}
+	catch (const std::exception& e) {
+		// Catch other standard exceptions
+		std::cerr << "Standard exception: " << e.what() << "\n";
+
+		return false;
+	} catch (...) {
+		// Catch any other exceptions
+		std::cerr << "Unknown exception caught \n";
+
+		return false;
+	}
+}
+
+bool sfct_api::ext::uring_copy_file(path src,path dst,fs::copy_options co,application::cs commands) noexcept
+{
+#if LINUX_BUILD
+    Linux::UringEngine* engine = private_uring();
+    if(engine != nullptr){
+        return engine->submit(src,dst,co,(commands & application::cs::nocache) != application::cs::none);
+    }
+#endif
+    return false;
+}
+
+void sfct_api::ext::uring_wait() noexcept
+{
+#if LINUX_BUILD
+    Linux::UringEngine* engine = private_uring();
+    if(engine != nullptr){
+        engine->wait();
+    }
+#endif
+}
+
+bool sfct_api::ext::batch_small_files(application::cs commands) noexcept
+{
+#if LINUX_BUILD
+    using application::cs;
+    return (commands & (cs::reflink | cs::nocache | cs::direct)) == cs::none;
+#else
+    return false;
+#endif
+}
+
+std::vector<application::file_queue_info> sfct_api::ext::copy_file_batch(const std::vector<application::file_queue_info>& batch) noexcept
+{
+    std::vector<application::file_queue_info> rest;
+
+    try{
+#if LINUX_BUILD
+        // one buffer for the whole batch, every file is read into it whole and written from it
+        application::buffer_pool::lease buffer = lease_buffer(SmallFileMaxSize);
+        if(!buffer){
+            return batch;
+        }
+
+        for(const auto& entry:batch){
+            application::copy_file_ext _cfe{false,{},application::copy_strategy::none};
+            bool verify = (entry.commands & application::cs::verify) != application::cs::none;
+            if(!Linux::CopySmallFile(entry.src,entry.dst,entry.co,buffer.data(),buffer.size(),_cfe,verify)){
+                rest.push_back(entry);
+                continue;
+            }
+
+            // small files are never reported by take_file_throughput(), the time is not measured
+            private_copy_done(entry.src,_cfe,0.0);
+        }
+        return rest;
+#else
+        return batch;
+#endif
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+
+        return rest;
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error :" << e.what() << "\n";
+
+        return rest;
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+
+        return rest;
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+
+        return rest;
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+
+        return rest;
+    }
+}
+
+#if LINUX_BUILD
+Linux::UringEngine* sfct_api::ext::private_uring() noexcept
+{
+    // created the first time a -uring job copies a file
+    static Linux::UringEngine engine(UringQueueDepth,UringBufferSize,[](const fs::path& src,const application::copy_file_ext& _cfe,double_t seconds){
+        private_copy_done(src,_cfe,seconds);
+    });
+
+    if(!engine.available()){
+        return nullptr;
+    }
+    return &engine;
+}
+#endif
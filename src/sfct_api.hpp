@@ -10,6 +10,18 @@
 #include <unordered_set>
 #include "args.hpp"
 #include <functional>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include "constants.hpp"
+#include "checksum.hpp"
+#include "buffer_pool.hpp"
+#include "linux_helper.hpp"
+#include "linux_uring.hpp"
 
 
 // INFO:
@@ -50,8 +62,9 @@ namespace sfct_api{
             /// @param src any path
             /// @param dst any path 
             /// @param co any copy options 
+            /// @param commands (optional) the job commands, cs::reflink clones the file on filesystems that support it
             /// @return true if no error, false for error
-            static bool copy_file(path src,path dst,fs::copy_options co) noexcept;
+            static bool copy_file(path src,path dst,fs::copy_options co,application::cs commands=application::cs::none) noexcept;
 
             /// @brief removes root path of entry and combines it with base
             /// @param entry any path
@@ -121,17 +134,25 @@ namespace sfct_api{
             /// @return if the entry is in use it returns false, if it is not in use it returns true.
             static bool is_entry_available(path entry) noexcept;
 
+            /// @brief checks a file if it is currently being used, the status is not read again.
+            /// @param entry any path
+            /// @param s the status of entry
+            /// @return if the entry is in use it returns false, if it is not in use it returns true.
+            static bool is_entry_available(path entry,const fs::file_status& s) noexcept;
+
             /// @brief checks the last write times in a 250ms interval. Then compares the times to see if they are equal, if they are it returns false else true.
             /// @param entry any path
             /// @return true if the entry is being transferred into entry path, false if it isnt.
             static bool is_entry_in_transit(path entry) noexcept;
 
-            /// @brief wrapper for std::filesystem::copy(). 
+            /// @brief wrapper for std::filesystem::copy(). On linux builds regular files and the files in directories are copied with
+            /// ext::copy_file() so they go through the linux copy engine.
             /// @param src any path
             /// @param dst any path
             /// @param co any copy_options
+            /// @param commands (optional) the job commands passed on to ext::copy_file()
             /// @attention there was an error it is logged.
-            static void copy_entry(path src,path dst,fs::copy_options co) noexcept;
+            static void copy_entry(path src,path dst,fs::copy_options co,application::cs commands=application::cs::none) noexcept;
 
             /// @brief checks if dst is missing files found in src.
             /// @param src any path
@@ -142,6 +163,16 @@ namespace sfct_api{
             /// an unordered_map key is dst and value is src
             static std::optional<std::shared_ptr<std::unordered_map<fs::path,fs::path>>> are_directories_synced(path src,path dst,bool recursive_sync=true) noexcept;
 
+            /// @brief compares src and dst one directory level at a time. The names of both levels are sorted and merged,
+            /// so only the two levels being compared are held in memory, not the whole tree.
+            /// @param src any path
+            /// @param dst any path
+            /// @param recursive compares the subtrees too
+            /// @param fn called for every difference. An added directory is reported with every entry below it,
+            /// a removed directory is reported once. A regular file changed if its size differs or the source is newer.
+            /// @return false if a directory could not be read, the entries that were read are still reported
+            static bool diff_directories(path src,path dst,bool recursive,const std::function<void(const application::directory_diff&)>& fn) noexcept;
+
             /// @brief logs an error code to the console and log file
             /// @param e error code
             /// @param p path that caused the error code
@@ -158,13 +189,19 @@ namespace sfct_api{
             /// if there was no error the target path is returned
             static std::optional<fs::path> read_symlink(path src_link) noexcept;
 
-            /// @brief checks an entry if its available and if its not then checks if it is being transfered, if it is being actively transfered then it will
-            /// wait 250ms and check again until it stops being transfered. Then it will check one last time if the entry is available it will return true if it is and
-            /// false if it isnt.
+            /// @brief checks if an entry is available. It does not wait for a writer to finish, 
+            /// an entry that is not available should be tried again later.
             /// @param entry any path
             /// @return true for available and false for not.
             static bool entry_check(path entry) noexcept; 
 
+            /// @brief entry_check() for an entry whose status is already known, like the fs_src of a file_queue_info.
+            /// On linux regular files are not probed, files are not locked while they are open and the copy opens the file anyway.
+            /// @param entry any path
+            /// @param s the status of entry
+            /// @return true for available and false for not.
+            static bool entry_check(path entry,const fs::file_status& s) noexcept;
+
             /// @brief renames an entry
             /// @param old_entry any path
             /// @param new_entry any path
@@ -205,7 +242,170 @@ namespace sfct_api{
             /// @brief gets the current working directory. wrapper for private_current_path().
             /// @return nothing if an exception is thrown. The current working directory path if no errors and no exceptions.
             static std::optional<fs::path> get_current_path() noexcept;
+
+            /// @brief gets the number of files ext::copy_file() has copied with a strategy since the program started.
+            /// @param strategy any copy strategy
+            /// @return the number of files
+            static std::uintmax_t get_copy_strategy_count(application::copy_strategy strategy) noexcept;
+
+            /// @brief walks dir and calls consumer for every entry found. Subdirectories are scanned in parallel on TM::shared(),
+            /// the calling thread scans directories too when it has no entries to consume so the walk never waits on busy workers.
+            /// consumer is only called on the calling thread, a directory entry is always passed to consumer before the entries inside it.
+            /// Directories that fail to open are logged and skipped.
+            /// @param dir any directory
+            /// @param recursive walk the subtree, if false only the entries in dir are passed to consumer
+            /// @param consumer called once for every entry
+            /// @param options directory options, directory symlinks are only walked with follow_directory_symlink
+            static void walk_directory(path dir,bool recursive,const std::function<void(const fs::directory_entry&)>& consumer,fs::directory_options options=fs::directory_options::none) noexcept;
+
+            /// @brief gets the status of a directory entry. The type read with the directory listing is used so there is no syscall,
+            /// the entry is only stat'ed if it is a symlink or the filesystem did not report the type.
+            /// @param entry any directory entry
+            /// @return the status of the entry, a file_status with file_type::none if it could not be read.
+            static fs::file_status entry_status(const fs::directory_entry& entry) noexcept;
+
+            /// @brief makes the destination path of src without touching the disk. src must be inside src_base.
+            /// Directories are created at the destination, the parents of files are not checked because 
+            /// walk_directory() passes a directory before the entries inside it.
+            /// @param src any path inside src_base
+            /// @param s the status of src
+            /// @param dst the destination directory
+            /// @param src_base the directory src was found in
+            /// @return the destination path, nothing if src is not inside src_base or the directory could not be created.
+            static std::optional<fs::path> create_entry_relative_path(path src,const fs::file_status& s,path dst,path src_base) noexcept;
+
+            /// @brief gets the number of metadata calls (exists, status, stat, relative paths, open checks) sfct_api has made since the program started.
+            /// @return the number of metadata calls
+            static std::uintmax_t get_metadata_call_count() noexcept;
+
+            /// @brief gets the bytes of holes in sparse files that were not copied since the program started.
+            /// @return the number of bytes skipped
+            static std::uintmax_t get_sparse_bytes_skipped() noexcept;
+
+            /// @brief gets the total size of the files updated by delta copies since the program started.
+            /// @return the number of bytes compared
+            static std::uintmax_t get_delta_bytes() noexcept;
+
+            /// @brief gets the bytes delta copies wrote since the program started, the rest of get_delta_bytes() was already the same.
+            /// @return the number of bytes written
+            static std::uintmax_t get_delta_bytes_written() noexcept;
+
+            /// @brief gets the bytes of the copies -verify read back and found to match since the program started.
+            /// @return the number of bytes verified
+            static std::uintmax_t get_verified_bytes() noexcept;
+
+            /// @brief gets the number of copies -verify found to differ from the source since the program started.
+            /// @return the number of files that failed verification
+            static std::uintmax_t get_verify_failures() noexcept;
+
+            /// @brief gets the number of copies that failed or were skipped since the program started, see count_copy_failure().
+            /// A failed -verify is counted too.
+            /// @return the number of failed copies
+            static std::uintmax_t get_copy_failures() noexcept;
+
+            /// @brief counts a copy that failed or a file that was skipped for get_copy_failures() and get_thread_copy_failures().
+            /// ext::copy_file() and ext::copy_entry() count their own failures.
+            static void count_copy_failure() noexcept;
+
+            /// @brief gets the number of copies ext::copy_file() and ext::copy_entry() failed to make on the calling thread since it started.
+            /// Compare the value before and after a copy to learn if the copy failed.
+            /// @return the number of failed copies of the calling thread
+            static std::uintmax_t get_thread_copy_failures() noexcept;
+
+            /// @brief gets the memory the system uses to cache file data, the Cached line of /proc/meminfo on linux.
+            /// @return the size in bytes, nothing if the platform does not report it
+            static std::optional<std::uintmax_t> get_page_cache_size() noexcept;
+
+            /// @brief leases a buffer from the process wide buffer pools. The size is rounded up to a power of two, the buffer is page
+            /// aligned and buffers of HugePageSize or larger are backed by huge pages on linux. The old contents of a reused buffer are kept.
+            /// @param size the least number of bytes the buffer must hold, at most SharedBufferMaxSize
+            /// @return the lease, empty if the buffer could not be allocated. the buffer goes back to the pool when the lease is destroyed
+            static application::buffer_pool::lease lease_buffer(std::size_t size) noexcept;
+
+            /// @brief hands a leased buffer back to its pool before the lease is destroyed, the lease is empty afterwards.
+            /// @param buffer any lease
+            static void return_buffer(application::buffer_pool::lease& buffer) noexcept;
+
+            /// @brief takes the transfer speeds of the files of ThroughputReportSize or larger that ext::copy_file() copied since the last call.
+            /// @return the files in the order they finished copying
+            static std::vector<application::file_throughput> take_file_throughput() noexcept;
+
+            /// @brief queues a regular file on the io_uring copy engine, the result is logged and counted like ext::copy_file() when it finishes.
+            /// Waits if the engine has too many files queued.
+            /// @param src any regular file
+            /// @param dst any path, must include the file name
+            /// @param co any copy options
+            /// @param commands cs::nocache drops the file from the page cache as it is copied, other commands are not used
+            /// @return false if io_uring is not available on this system or build, the file is not queued and should be copied with ext::copy_file()
+            static bool uring_copy_file(path src,path dst,fs::copy_options co,application::cs commands=application::cs::none) noexcept;
+
+            /// @brief waits until every file queued with uring_copy_file() is finished
+            static void uring_wait() noexcept;
+
+            /// @brief checks if the files of a job can be copied in small file batches with copy_file_batch(). A batch only makes
+            /// a plain copy or a -verify copy, -reflink, -nocache and -direct need ext::copy_file().
+            /// @param commands the job commands
+            /// @return true if the files can be batched, always false on other platforms than linux
+            static bool batch_small_files(application::cs commands) noexcept;
+
+            /// @brief copies a batch of regular files on the calling thread. On linux each file of SmallFileMaxSize or smaller is copied
+            /// with Linux::CopySmallFile() through one leased buffer, the result is logged and counted like ext::copy_file().
+            /// @param batch the files, dst must include the file name
+            /// @return the files that were not copied because they are too large or not regular files, in the order of batch.
+            /// Copy them with ext::copy_file(). Every file is returned on other platforms than linux.
+            static std::vector<application::file_queue_info> copy_file_batch(const std::vector<application::file_queue_info>& batch) noexcept;
         private:
+            /// @brief logs the error of a finished copy or counts its strategy, metadata calls and transfer speed.
+            /// @param src the copied file
+            /// @param _cfe the result of the copy
+            /// @param seconds how long the copy took
+            /// @return true if there was no error
+            static bool private_copy_done(path src,const application::copy_file_ext& _cfe,double_t seconds) noexcept;
+
+#if LINUX_BUILD
+            /// @brief the io_uring copy engine shared by every -uring job
+            /// @return nothing if io_uring could not be set up
+            static Linux::UringEngine* private_uring() noexcept;
+#endif
+
+            /// @brief transfer speeds of large copied files, see take_file_throughput()
+            inline static std::vector<application::file_throughput> m_throughput;
+            inline static std::mutex m_throughput_mtx;
+
+            /// @brief number of metadata calls made by sfct_api, see get_metadata_call_count()
+            inline static std::atomic<std::uintmax_t> m_metadata_calls{};
+
+            /// @brief bytes of holes skipped by sparse copies, see get_sparse_bytes_skipped()
+            inline static std::atomic<std::uintmax_t> m_sparse_bytes{};
+
+            /// @brief size of the files updated by delta copies and the bytes written to them, see get_delta_bytes()
+            inline static std::atomic<std::uintmax_t> m_delta_bytes{};
+            inline static std::atomic<std::uintmax_t> m_delta_written{};
+
+            /// @brief bytes -verify found to match and files it found to differ, see get_verified_bytes()
+            inline static std::atomic<std::uintmax_t> m_verified_bytes{};
+            inline static std::atomic<std::uintmax_t> m_verify_failures{};
+
+            /// @brief copies that failed, and the ones that failed on this thread, see get_copy_failures()
+            inline static std::atomic<std::uintmax_t> m_copy_failures{};
+            inline static thread_local std::uintmax_t t_copy_failures{};
+
+            /// @brief state shared by walk_directory() and its scan tasks, defined in sfct_api.cpp
+            struct walk_state;
+
+            /// @brief reads the entries of one directory for walk_directory(), the entries are queued for the consumer
+            /// and the subdirectories are queued for scanning
+            /// @param state the walk the directory belongs to
+            /// @param dir the directory to scan
+            static void private_walk_scan(const std::shared_ptr<walk_state>& state,const fs::path& dir) noexcept;
+
+            /// @brief takes one queued directory from state and scans it. This is the task queued on TM::shared().
+            /// @param state the walk to help
+            static void private_walk_task(std::shared_ptr<walk_state> state) noexcept;
+
+            /// @brief number of files copied by each copy strategy, indexed by application::copy_strategy
+            inline static std::array<std::atomic<std::uintmax_t>,static_cast<size_t>(application::copy_strategy::count)> m_copy_strategy_count{};
+
             /// @brief gets the current working directory. wrapper for std::filesystem::current_path().
             /// @return a path_ext object with current working directory and error code.
             /// if an exception is thrown, nothing is returned.
@@ -272,12 +472,20 @@ namespace sfct_api{
             /// @return a file_size_ext object which contains the size and error code.
             static application::file_size_ext private_get_file_size(path entry) noexcept;
 
-            /// @brief wrapper for std::filesystem::copy_file(src,dst,co,error_code)
+            /// @brief wrapper for std::filesystem::copy_file(src,dst,co,error_code). On linux builds Linux::CopyFile() is used instead
+            /// so the kernel copies the data with copy_file_range or sendfile when it can.
             /// @param src: any path
             /// @param dst: any path
             /// @param co: any copy options
-            /// @return a copy_file_ext object which contains the error code and returned value from the function std::filesystem::copy_file()
-            static application::copy_file_ext private_copy_file(path src,path dst,fs::copy_options co) noexcept;
+            /// @param commands: the job commands, cs::reflink tries to clone the file first, cs::fast_copy memory maps files in the FastCopy size band
+            /// @return a copy_file_ext object which contains the error code, returned value and the strategy used to copy the file
+            static application::copy_file_ext private_copy_file(path src,path dst,fs::copy_options co,application::cs commands) noexcept;
+
+            /// @brief -verify on builds without Linux::VerifyCopy(). Reads both files and compares their CRC32C checksums.
+            /// @param src the source of the copy
+            /// @param dst the copied file
+            /// @param _cfe verified and verify_mismatch are set, e gets any read error
+            static void private_verify_copy(path src,path dst,application::copy_file_ext& _cfe) noexcept;
     };
 
 
@@ -286,12 +494,18 @@ namespace sfct_api{
     /// @return true if the entry is available, false if in use.
     bool is_entry_available(path entry) noexcept;
 
-    /// @brief waits in 250ms intervals until an entry has been completly copied into entry path. Then checks if the entry is available.
+    /// @brief checks if an entry is available, it does not wait for a writer to finish.
     /// Checks if entry exists on the system if it doesnt it returns false.
     /// @param entry must exist on the system
     /// @return true if the entry is available and false if it isnt. False if entry doesnt exist in the system.
     bool entry_check(path entry) noexcept; 
 
+    /// @brief wrapper for ext::entry_check(entry,s). The status is not read again.
+    /// @param entry any path
+    /// @param s the status of entry, like the fs_src of a file_queue_info
+    /// @return true if the entry is available and false if it isnt.
+    bool entry_check(path entry,const fs::file_status& s) noexcept;
+
     /// @brief if the source path doesnt exist the directory is created 
     /// @param src source path: can be a file entry or directory
     /// @return if the source path already exists the function returns false.
@@ -356,9 +570,10 @@ namespace sfct_api{
     /// @param src source file path
     /// @param dst destination path, could be a directory or include a file name in the path.
     /// @param co any copy options
+    /// @param commands (optional) the job commands passed on to ext::copy_file()
     /// @return if src or dst is not valid on the system false is returned.
     /// when it calls ext::copy_file() it returns: true if no error, false if error.
-    bool copy_file(path src,path dst,fs::copy_options co) noexcept;
+    bool copy_file(path src,path dst,fs::copy_options co,application::cs commands=application::cs::none) noexcept;
 
     /// @brief copies a file to a dst path that is created. 
     /// @param src source file: must be a regular file on the system
@@ -407,9 +622,10 @@ namespace sfct_api{
     /// @param dst if it does not exist it may get created. see description.
     /// @param co any copy options
     /// @param create_dst specifies whether to create the dst directory explictly or not. If it is false the directory may still get created, see description.
-    void copy_entry(path src,path dst,fs::copy_options co,bool create_dst=false) noexcept;
+    /// @param commands (optional) the job commands passed on to ext::copy_entry()
+    void copy_entry(path src,path dst,fs::copy_options co,bool create_dst=false,application::cs commands=application::cs::none) noexcept;
 
-    /// @brief wrapper for ext::are_directories_synced(). very slow function.
+    /// @brief wrapper for ext::are_directories_synced(). walks both trees, see diff_directories() to stream the differences instead.
     /// @param src must be a directory on the system
     /// @param dst must be a directory on the system
     /// @param recursive_sync (optional) checks subtree.
@@ -417,6 +633,14 @@ namespace sfct_api{
     /// the missing file paths not found in dst but exist in src. if no missing files are found nothing is returned.
     /// an unordered_map key is dst and value is src
     std::optional<std::shared_ptr<std::unordered_map<fs::path,fs::path>>> are_directories_synced(path src,path dst,bool recursive_sync=true) noexcept;
+
+    /// @brief wrapper for ext::diff_directories()
+    /// @param src must be a directory on the system
+    /// @param dst must be a directory on the system
+    /// @param recursive compares the subtrees too
+    /// @param fn called for every added, removed or changed entry
+    /// @return false if src or dst is not a directory or could not be read
+    bool diff_directories(path src,path dst,bool recursive,const std::function<void(const application::directory_diff&)>& fn) noexcept;
     
     /// @brief wrapper for ext::get_directory_info
     /// @param dir dir.source must exist on the system
@@ -481,4 +705,101 @@ namespace sfct_api{
     /// @brief multithreaded safe function version of process_file_queue_info_entry. A copy of entry is made.
     /// @param entry any entry
     void mt_process_file_queue_info_entry(application::file_queue_info entry);
+
+    /// @brief wrapper for ext::get_copy_strategy_count().
+    /// @param strategy any copy strategy
+    /// @return the number of files copied with strategy since the program started
+    std::uintmax_t get_copy_strategy_count(application::copy_strategy strategy) noexcept;
+
+    /// @brief wrapper for ext::walk_directory(). Walks dir in parallel and streams the entries to consumer on the calling thread.
+    /// @param dir must be a directory existing on the system
+    /// @param recursive walk the subtree
+    /// @param consumer called once for every entry, a directory entry is passed before the entries inside it
+    /// @param options (optional) directory options
+    /// @return false if dir is not a directory, true once every entry has been passed to consumer
+    bool walk_directory(path dir,bool recursive,const std::function<void(const fs::directory_entry&)>& consumer,fs::directory_options options=fs::directory_options::none) noexcept;
+
+    /// @brief wrapper for ext::entry_status(). Uses the type from the directory listing instead of another stat.
+    /// @param entry any entry from a directory iterator or walk_directory()
+    /// @return the status of the entry
+    fs::file_status get_entry_status(const fs::directory_entry& entry) noexcept;
+
+    /// @brief wrapper for ext::create_entry_relative_path(). The path is made lexically so src must be a path found by walking src_base,
+    /// use create_file_relative_path() for any other path.
+    /// @param src any path inside src_base
+    /// @param s the status of src, a directory is created at the destination
+    /// @param dst destination directory
+    /// @param src_base the directory being walked
+    /// @return destination path
+    std::optional<fs::path> create_entry_relative_path(path src,const fs::file_status& s,path dst,path src_base) noexcept;
+
+    /// @brief wrapper for ext::get_metadata_call_count().
+    /// @return the number of metadata calls sfct_api has made since the program started
+    std::uintmax_t get_metadata_call_count() noexcept;
+
+    /// @brief wrapper for ext::get_sparse_bytes_skipped().
+    /// @return the bytes of holes in sparse files that were not copied since the program started
+    std::uintmax_t get_sparse_bytes_skipped() noexcept;
+
+    /// @brief wrapper for ext::get_delta_bytes().
+    /// @return the size of the files updated by delta copies since the program started
+    std::uintmax_t get_delta_bytes() noexcept;
+
+    /// @brief wrapper for ext::get_delta_bytes_written().
+    /// @return the bytes delta copies wrote since the program started
+    std::uintmax_t get_delta_bytes_written() noexcept;
+
+    /// @brief wrapper for ext::get_verified_bytes().
+    /// @return the bytes -verify found to match since the program started
+    std::uintmax_t get_verified_bytes() noexcept;
+
+    /// @brief wrapper for ext::get_verify_failures().
+    /// @return the number of copies -verify found to differ since the program started
+    std::uintmax_t get_verify_failures() noexcept;
+
+    /// @brief wrapper for ext::get_copy_failures().
+    /// @return the number of copies that failed or were skipped since the program started
+    std::uintmax_t get_copy_failures() noexcept;
+
+    /// @brief wrapper for ext::get_thread_copy_failures().
+    /// @return the number of copies that failed on the calling thread since it started
+    std::uintmax_t get_thread_copy_failures() noexcept;
+
+    /// @brief wrapper for ext::get_page_cache_size().
+    /// @return the memory the system uses to cache file data in bytes, nothing if the platform does not report it
+    std::optional<std::uintmax_t> get_page_cache_size() noexcept;
+
+    /// @brief wrapper for ext::lease_buffer(). Leases a page aligned buffer from the process wide pools.
+    /// @param size the least number of bytes the buffer must hold
+    /// @return the lease, empty if the buffer could not be allocated or size is too large
+    application::buffer_pool::lease lease_buffer(std::size_t size) noexcept;
+
+    /// @brief wrapper for ext::return_buffer(). Hands a leased buffer back to its pool.
+    /// @param buffer any lease, it is empty afterwards
+    void return_buffer(application::buffer_pool::lease& buffer) noexcept;
+
+    /// @brief wrapper for ext::take_file_throughput().
+    /// @return the transfer speeds of the large files copied since the last call
+    std::vector<application::file_throughput> take_file_throughput() noexcept;
+
+    /// @brief wrapper for ext::uring_copy_file(). Queues a regular file on the io_uring copy engine.
+    /// @param src regular file
+    /// @param dst destination file path
+    /// @param co any copy options
+    /// @param commands the job commands, see ext::uring_copy_file()
+    /// @return false if the file was not queued because io_uring is not available, copy it another way
+    bool uring_copy_file(path src,path dst,fs::copy_options co,application::cs commands=application::cs::none) noexcept;
+
+    /// @brief wrapper for ext::uring_wait(). Waits for every file queued with uring_copy_file().
+    void uring_wait() noexcept;
+
+    /// @brief wrapper for ext::batch_small_files().
+    /// @param commands the job commands
+    /// @return true if the files of the job can be copied with copy_file_batch()
+    bool batch_small_files(application::cs commands) noexcept;
+
+    /// @brief wrapper for ext::copy_file_batch(). Copies the small files of a batch on the calling thread.
+    /// @param batch regular files and their destination file paths
+    /// @return the files that are too large for a batch, copy them one by one
+    std::vector<application::file_queue_info> copy_file_batch(const std::vector<application::file_queue_info>& batch) noexcept;
 }
\ No newline at end of file
@@ -0,0 +1,741 @@
+#include "sync_index.hpp"
+#include "sfct_api.hpp"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+
+#if LINUX_BUILD
+#include <sys/stat.h>
+#endif
+
+application::sync_index::sync_index(const copyto& job) noexcept
+:m_job(job)
+{
+    try{
+        // FNV-1a of everything that makes the job what it is, a changed job starts with a new index
+        m_job_hash = 14695981039346656037ull;
+        auto add = [this](const void* data,std::size_t size){
+            for(std::size_t i = 0; i < size; i++){
+                m_job_hash ^= static_cast<const unsigned char*>(data)[i];
+                m_job_hash *= 1099511628211ull;
+            }
+        };
+        add(m_job.source.native().data(),m_job.source.native().size() * sizeof(std::filesystem::path::value_type));
+        add("",1);
+        add(m_job.destination.native().data(),m_job.destination.native().size() * sizeof(std::filesystem::path::value_type));
+        add(&m_job.commands,sizeof(m_job.commands));
+
+        // next to the destination and not inside it, so -sync does not see it as an entry src does not have
+        std::filesystem::path destination = m_job.destination;
+        if(!destination.has_filename()){
+            destination = destination.parent_path();
+        }
+
+        std::ostringstream hash;
+        hash << std::hex << std::setw(16) << std::setfill('0') << m_job_hash;
+
+        std::filesystem::path::string_type name = std::filesystem::path(".").native();
+        name += destination.has_filename() ? destination.filename().native() : std::filesystem::path("root").native();
+        name += std::filesystem::path("." + hash.str() + ".sfct_index").native();
+        m_file = destination.parent_path()/name;
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+bool application::sync_index::load() noexcept
+{
+    try{
+        std::ifstream in(m_file,std::ios::binary);
+        if(!in){
+            return false;
+        }
+
+        disk_header header{};
+        in.read(reinterpret_cast<char*>(&header),sizeof(header));
+        if(!in || std::memcmp(header.magic,IndexMagic,sizeof(IndexMagic)) != 0 || header.version != IndexVersion || header.job_hash != m_job_hash){
+            return false;
+        }
+
+        std::vector<disk_record> records(header.record_count);
+        std::filesystem::path::string_type names(header.name_size,std::filesystem::path::value_type{});
+        in.read(reinterpret_cast<char*>(records.data()),records.size() * sizeof(disk_record));
+        in.read(reinterpret_cast<char*>(names.data()),names.size() * sizeof(std::filesystem::path::value_type));
+        if(!in){
+            return false;
+        }
+
+        // only the relative paths of directories are needed to place their entries
+        std::unordered_map<std::filesystem::path::string_type,directory_record> directories;
+        std::vector<std::filesystem::path::string_type> relative(records.size());
+        for(std::size_t i = 0; i < records.size(); i++){
+            const disk_record& r = records[i];
+            if(r.name_offset + r.name_length > names.size() || (r.parent != NoParent && r.parent >= i)){
+                return false;
+            }
+
+            entry_record e{r.size,r.mtime,r.inode,r.hash,static_cast<std::filesystem::file_type>(r.type),r.mode};
+            if(r.parent != NoParent){
+                auto parent = directories.find(relative[r.parent]);
+                if(parent == directories.end() || !records[r.parent].listed){
+                    return false;
+                }
+
+                auto name = names.substr(r.name_offset,r.name_length);
+                if(r.listed){
+                    relative[i] = join(relative[r.parent],name);
+                }
+                parent->second.entries.emplace(std::move(name),e);
+            }
+
+            if(r.listed){
+                directories[relative[i]].self = e;
+            }
+        }
+
+        m_directories = std::move(directories);
+        m_touched.clear();
+        m_stale_digests.clear();
+        m_unsaved = false;
+        return true;
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    return false;
+}
+
+bool application::sync_index::save() noexcept
+{
+    try{
+        auto root = m_directories.find(std::filesystem::path::string_type());
+        if(root == m_directories.end()){
+            return false;
+        }
+
+        std::vector<disk_record> records;
+        std::filesystem::path::string_type names;
+
+        auto make_record = [](const entry_record& e,std::uint32_t parent,bool listed){
+            disk_record r{};
+            r.size = e.size;
+            r.mtime = e.mtime;
+            r.inode = e.inode;
+            r.hash = e.hash;
+            r.parent = parent;
+            r.type = static_cast<std::uint8_t>(e.type);
+            r.listed = listed;
+            r.mode = e.mode;
+            return r;
+        };
+
+        // breadth first, so a directory's record is always written before its entries
+        std::vector<std::pair<const std::filesystem::path::string_type*,std::uint32_t>> directories{{&root->first,0}};
+        records.push_back(make_record(root->second.self,NoParent,true));
+        for(std::size_t i = 0; i < directories.size(); i++){
+            auto [relative,index] = directories[i];
+            for(const auto& [name,e]:m_directories.at(*relative).entries){
+                auto listing = e.type == std::filesystem::file_type::directory ? m_directories.find(join(*relative,name)) : m_directories.end();
+                bool listed = listing != m_directories.end();
+
+                disk_record r = make_record(listed ? listing->second.self : e,index,listed);
+                r.name_offset = names.size();
+                r.name_length = static_cast<std::uint32_t>(name.size());
+                names += name;
+                records.push_back(r);
+
+                if(listed){
+                    directories.push_back({&listing->first,static_cast<std::uint32_t>(records.size() - 1)});
+                }
+            }
+        }
+
+        disk_header header{};
+        std::memcpy(header.magic,IndexMagic,sizeof(IndexMagic));
+        header.version = IndexVersion;
+        header.record_count = records.size();
+        header.name_size = names.size();
+        header.job_hash = m_job_hash;
+
+        std::error_code e;
+        std::filesystem::create_directories(m_file.parent_path(),e);
+
+        std::filesystem::path tmp = m_file;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp,std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header),sizeof(header));
+            out.write(reinterpret_cast<const char*>(records.data()),records.size() * sizeof(disk_record));
+            out.write(reinterpret_cast<const char*>(names.data()),names.size() * sizeof(std::filesystem::path::value_type));
+            if(!out.flush()){
+                logger log(App_MESSAGE("Could not write the sync index"),Error::WARNING,tmp);
+                log.to_console();
+                log.to_log_file();
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tmp,m_file,e);
+        if(e){
+            logger log(e,Error::WARNING,m_file);
+            log.to_console();
+            log.to_log_file();
+            return false;
+        }
+
+        m_unsaved = false;
+        return true;
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    return false;
+}
+
+void application::sync_index::reconcile(const change_callback& changed,const std::function<void()>& every_entry) noexcept
+{
+    scan({std::filesystem::path::string_type()},true,false,changed,every_entry);
+}
+
+void application::sync_index::touch(const std::filesystem::path::string_type& relative) noexcept
+{
+    try{
+        m_touched.insert(std::filesystem::path(relative).parent_path().native());
+    }
+    catch (const std::exception& e) {
+        // Catch standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::sync_index::refresh() noexcept
+{
+    if(m_touched.empty()){
+        return;
+    }
+
+    std::vector<std::filesystem::path::string_type> start(m_touched.begin(),m_touched.end());
+    m_touched.clear();
+    scan(std::move(start),false,true,[](const std::filesystem::path&,const std::filesystem::path::string_type&,file_queue_status,std::filesystem::file_type){},{});
+
+    try{
+        drop_failed();
+    }
+    catch (const std::exception& e) {
+        // Catch standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::sync_index::failed(const std::filesystem::path::string_type& relative) noexcept
+{
+    try{
+        m_failed.insert(relative);
+        drop_failed();
+    }
+    catch (const std::exception& e) {
+        // Catch standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::sync_index::copied(const std::filesystem::path::string_type& relative) noexcept
+{
+    m_failed.erase(relative);
+}
+
+bool application::sync_index::contains(const std::filesystem::path::string_type& relative) const noexcept
+{
+    try{
+        std::filesystem::path p(relative);
+        auto listing = m_directories.find(p.parent_path().native());
+        return listing != m_directories.end() && listing->second.entries.contains(p.filename().native());
+    }
+    catch (const std::exception& e) {
+        // Catch standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+    return false;
+}
+
+std::uint64_t application::sync_index::digest(const std::filesystem::path::string_type& relative) const noexcept
+{
+    auto listing = m_directories.find(relative);
+    return listing == m_directories.end() ? 0 : listing->second.self.hash;
+}
+
+std::uintmax_t application::sync_index::size() const noexcept
+{
+    std::uintmax_t entries{};
+    for(const auto& [relative,listing]:m_directories){
+        entries += listing.entries.size();
+    }
+    return entries;
+}
+
+bool application::sync_index::destination_matches() const noexcept
+{
+    try{
+        if(m_directories.empty()){
+            return false;
+        }
+
+        bool recursive = sfct_api::recursive_flag_check(m_job.commands);
+        for(const auto& [directory,listing]:m_directories){
+            for(const auto& [name,e]:listing.entries){
+                // without -recursive the directories of src are not copied
+                if(e.type == std::filesystem::file_type::directory && !recursive){
+                    continue;
+                }
+
+                auto relative = join(directory,name);
+                entry_record dst = read_record(m_job.destination/relative);
+                if(dst.type == std::filesystem::file_type::not_found){
+                    return false;
+                }
+
+                bool typed = e.type == std::filesystem::file_type::directory || e.type == std::filesystem::file_type::regular;
+                if(typed && dst.type != e.type){
+                    return false;
+                }
+
+                // a copy is written after src was, an older or resized dst was changed since
+                if(e.type == std::filesystem::file_type::regular && (dst.size != e.size || dst.mtime < e.mtime)){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+
+    return false;
+}
+
+void application::sync_index::scan(std::vector<std::filesystem::path::string_type> start,bool deep,bool force,const change_callback& changed,
+                                   const std::function<void()>& every_entry) noexcept
+{
+    try{
+        struct pending_directory{
+            std::filesystem::path::string_type relative;
+            bool force;
+        };
+
+        std::vector<pending_directory> directories;
+        for(auto& relative:start){
+            directories.push_back({std::move(relative),force});
+        }
+
+        bool recursive = sfct_api::recursive_flag_check(m_job.commands);
+        while(!directories.empty()){
+            pending_directory current = std::move(directories.back());
+            directories.pop_back();
+
+            std::filesystem::path dir = source_path(current.relative);
+            entry_record now = read_record(dir);
+            if(now.type != std::filesystem::file_type::directory){
+                // gone, the listing of the directory it was in reports it
+                erase_directories(current.relative);
+                continue;
+            }
+
+            auto listing = m_directories.find(current.relative);
+            if(listing != m_directories.end() && !current.force && listing->second.self.same(now)){
+                // the directory has the same names as when it was read, only the entries themselves can have changed
+                std::vector<std::filesystem::path::string_type> removed;
+                for(auto& [name,e]:listing->second.entries){
+                    auto relative = join(current.relative,name);
+                    if(e.type == std::filesystem::file_type::directory){
+                        if(recursive){
+                            directories.push_back({std::move(relative),false});
+                        }
+                        continue;
+                    }
+
+                    entry_record child = read_record(dir/name);
+                    if(child.type == std::filesystem::file_type::not_found){
+                        changed(dir/name,relative,file_queue_status::file_removed,e.type);
+                        removed.push_back(name);
+                    }
+                    else if(!child.same(e)){
+                        changed(dir/name,relative,file_queue_status::file_updated,child.type);
+                        e = child;
+                        m_stale_digests.insert(current.relative);
+                        m_unsaved = true;
+                    }
+
+                    if(every_entry){
+                        every_entry();
+                    }
+                }
+
+                for(const auto& name:removed){
+                    listing->second.entries.erase(name);
+                    m_stale_digests.insert(current.relative);
+                    m_unsaved = true;
+                }
+                continue;
+            }
+
+            // read the directory and compare it with the entries it had
+            directory_record fresh;
+            fresh.self = now;
+            for(const auto& entry:std::filesystem::directory_iterator(dir,std::filesystem::directory_options::skip_permission_denied)){
+                auto name = entry.path().filename().native();
+                entry_record child = read_record(entry.path());
+                if(child.type == std::filesystem::file_type::not_found){
+                    // removed while the directory was read
+                    continue;
+                }
+
+                auto relative = join(current.relative,name);
+                const entry_record* old{nullptr};
+                if(listing != m_directories.end()){
+                    auto found = listing->second.entries.find(name);
+                    if(found != listing->second.entries.end()){
+                        old = &found->second;
+                    }
+                }
+
+                if(old == nullptr || old->type != child.type){
+                    // a directory replaced by something else takes its entries with it
+                    if(old != nullptr && old->type == std::filesystem::file_type::directory){
+                        erase_directories(relative);
+                    }
+
+                    changed(entry.path(),relative,file_queue_status::file_added,child.type);
+                    if(child.type == std::filesystem::file_type::directory && recursive){
+                        directories.push_back({relative,false});
+                    }
+                }
+                else if(child.type == std::filesystem::file_type::directory){
+                    if(recursive){
+                        // a directory that is up to date only has to be visited to check its files
+                        auto below = m_directories.find(relative);
+                        if(deep || below == m_directories.end() || !below->second.self.same(child)){
+                            directories.push_back({relative,false});
+                        }
+                    }
+                }
+                else if(!child.same(*old)){
+                    changed(entry.path(),relative,file_queue_status::file_updated,child.type);
+                }
+
+                fresh.entries.emplace(std::move(name),child);
+
+                if(every_entry){
+                    every_entry();
+                }
+            }
+
+            if(listing != m_directories.end()){
+                for(const auto& [name,e]:listing->second.entries){
+                    if(fresh.entries.contains(name)){
+                        continue;
+                    }
+
+                    auto relative = join(current.relative,name);
+                    changed(dir/name,relative,file_queue_status::file_removed,e.type);
+                    if(e.type == std::filesystem::file_type::directory){
+                        erase_directories(relative);
+                    }
+                }
+                listing->second = std::move(fresh);
+            }
+            else{
+                m_directories.emplace(current.relative,std::move(fresh));
+            }
+            m_stale_digests.insert(current.relative);
+            m_unsaved = true;
+        }
+
+        update_digests();
+    }
+    catch (const std::filesystem::filesystem_error& e) {
+        // Handle filesystem related errors
+        std::cerr << "Filesystem error: " << e.what() << "\n";
+    }
+    catch(const std::runtime_error& e){
+        // the error message
+        std::cerr << "Runtime error: " << e.what() << "\n";
+    }
+    catch(const std::bad_alloc& e){
+        // the error message
+        std::cerr << "Allocation error: " << e.what() << "\n";
+    }
+    catch (const std::exception& e) {
+        // Catch other standard exceptions
+        std::cerr << "Standard exception: " << e.what() << "\n";
+    } catch (...) {
+        // Catch any other exceptions
+        std::cerr << "Unknown exception caught \n";
+    }
+}
+
+void application::sync_index::erase_directories(const std::filesystem::path::string_type& relative) noexcept
+{
+    if(relative.empty()){
+        m_directories.clear();
+        m_unsaved = true;
+        return;
+    }
+
+    // the listings are keyed by path, not nested, so every key is checked
+    std::erase_if(m_directories,[&relative](const auto& listing){
+        const auto& key = listing.first;
+        return key.size() >= relative.size() && key.compare(0,relative.size(),relative) == 0 &&
+               (key.size() == relative.size() || key[relative.size()] == std::filesystem::path::preferred_separator);
+    });
+    m_unsaved = true;
+}
+
+void application::sync_index::drop_failed()
+{
+    for(const auto& relative:m_failed){
+        std::filesystem::path p(relative);
+        auto listing = m_directories.find(p.parent_path().native());
+        if(listing == m_directories.end()){
+            continue;
+        }
+
+        // a directory whose record does not match is read again, reconcile() finds the entry missing from the index and queues it
+        auto found = listing->second.entries.find(p.filename().native());
+        if(found == listing->second.entries.end() && listing->second.self.mtime == 0){
+            continue;
+        }
+
+        if(found != listing->second.entries.end()){
+            if(found->second.type == std::filesystem::file_type::directory){
+                erase_directories(relative);
+            }
+            listing->second.entries.erase(found);
+        }
+        listing->second.self.mtime = 0;
+        m_stale_digests.insert(listing->first);
+        m_unsaved = true;
+    }
+
+    update_digests();
+}
+
+void application::sync_index::update_digests()
+{
+    if(m_stale_digests.empty()){
+        return;
+    }
+
+    // a directory's digest covers its subdirectories, so everything above a stale directory is stale too
+    auto parent = [](const std::filesystem::path::string_type& relative){
+        auto separator = relative.find_last_of(std::filesystem::path::preferred_separator);
+        return separator == std::filesystem::path::string_type::npos ? std::filesystem::path::string_type() : relative.substr(0,separator);
+    };
+
+    std::unordered_set<std::filesystem::path::string_type> stale;
+    for(const auto& relative:m_stale_digests){
+        auto current = relative;
+        while(stale.insert(current).second && !current.empty()){
+            current = parent(current);
+        }
+    }
+    m_stale_digests.clear();
+
+    // deepest first, so the digests of the subdirectories are up to date when their parent is computed
+    std::vector<std::pair<std::size_t,const std::filesystem::path::string_type*>> order;
+    for(const auto& relative:stale){
+        std::size_t depth = relative.empty() ? 0 : std::count(relative.begin(),relative.end(),std::filesystem::path::preferred_separator) + 1;
+        order.push_back({depth,&relative});
+    }
+    std::sort(order.begin(),order.end(),[](const auto& a,const auto& b){return a.first > b.first;});
+
+    std::vector<std::pair<const std::filesystem::path::string_type*,const entry_record*>> entries;
+    for(const auto& [depth,relative]:order){
+        auto listing = m_directories.find(*relative);
+        if(listing == m_directories.end()){
+            continue;
+        }
+
+        // the entries are hashed in name order so the digest does not depend on the order they were read in
+        entries.clear();
+        for(const auto& [name,e]:listing->second.entries){
+            entries.push_back({&name,&e});
+        }
+        std::sort(entries.begin(),entries.end(),[](const auto& a,const auto& b){return *a.first < *b.first;});
+
+        // FNV-1a
+        std::uint64_t digest = 14695981039346656037ull;
+        auto add = [&digest](const void* data,std::size_t size){
+            for(std::size_t i = 0; i < size; i++){
+                digest ^= static_cast<const unsigned char*>(data)[i];
+                digest *= 1099511628211ull;
+            }
+        };
+
+        for(const auto& [name,e]:entries){
+            std::uint64_t below = e->hash;
+            if(e->type == std::filesystem::file_type::directory){
+                auto subdirectory = m_directories.find(join(*relative,*name));
+                below = subdirectory == m_directories.end() ? 0 : subdirectory->second.self.hash;
+            }
+
+            add(name->data(),(name->size() + 1) * sizeof(std::filesystem::path::value_type));
+            add(&e->size,sizeof(e->size));
+            add(&e->mtime,sizeof(e->mtime));
+            add(&e->type,sizeof(e->type));
+            add(&e->mode,sizeof(e->mode));
+            add(&below,sizeof(below));
+        }
+
+        listing->second.self.hash = digest;
+    }
+}
+
+std::filesystem::path application::sync_index::source_path(const std::filesystem::path::string_type& relative) const
+{
+    return relative.empty() ? m_job.source : m_job.source/relative;
+}
+
+std::filesystem::path::string_type application::sync_index::join(const std::filesystem::path::string_type& relative,const std::filesystem::path::string_type& name)
+{
+    if(relative.empty()){
+        return name;
+    }
+
+    std::filesystem::path::string_type joined;
+    joined.reserve(relative.size() + 1 + name.size());
+    joined += relative;
+    joined += std::filesystem::path::preferred_separator;
+    joined += name;
+    return joined;
+}
+
+application::sync_index::entry_record application::sync_index::read_record(const std::filesystem::path& p) noexcept
+{
+    entry_record record;
+
+#if LINUX_BUILD
+    // one lstat gives everything, the std::filesystem calls would take three
+    struct stat st;
+    if(lstat(p.c_str(),&st) != 0){
+        record.type = std::filesystem::file_type::not_found;
+        return record;
+    }
+
+    record.size = static_cast<std::uint64_t>(st.st_size);
+    record.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    record.inode = st.st_ino;
+    record.mode = st.st_mode & 07777;
+
+    if(S_ISREG(st.st_mode)) record.type = std::filesystem::file_type::regular;
+    else if(S_ISDIR(st.st_mode)) record.type = std::filesystem::file_type::directory;
+    else if(S_ISLNK(st.st_mode)) record.type = std::filesystem::file_type::symlink;
+    else if(S_ISBLK(st.st_mode)) record.type = std::filesystem::file_type::block;
+    else if(S_ISCHR(st.st_mode)) record.type = std::filesystem::file_type::character;
+    else if(S_ISFIFO(st.st_mode)) record.type = std::filesystem::file_type::fifo;
+    else if(S_ISSOCK(st.st_mode)) record.type = std::filesystem::file_type::socket;
+    else record.type = std::filesystem::file_type::unknown;
+#else
+    std::error_code e;
+    auto s = std::filesystem::symlink_status(p,e);
+    if(e || !std::filesystem::exists(s)){
+        record.type = std::filesystem::file_type::not_found;
+        return record;
+    }
+
+    record.type = s.type();
+    record.mode = static_cast<std::uint32_t>(s.permissions()) & 07777;
+    if(std::filesystem::is_regular_file(s)){
+        auto size = std::filesystem::file_size(p,e);
+        record.size = e ? 0 : size;
+    }
+
+    auto mtime = std::filesystem::last_write_time(p,e);
+    if(!e){
+        record.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    }
+#endif
+
+    return record;
+}
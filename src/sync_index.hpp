@@ -0,0 +1,174 @@
+#pragma once
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <cstdint>
+#include <vector>
+#include "obj.hpp"
+
+/////////////////////////////////////////////////////////////////////
+// The on-disk index of a monitor -sync or copy -update job.
+// It remembers every entry of the source tree as it was when the destination
+// was last in sync, so on startup only the differences have to be queued.
+// A directory whose modification time did not change still has the same
+// names, so it is not read again, only its files are checked.
+// Every directory also has a digest of the names, sizes, modification times
+// and modes of everything below it, so two states of a subtree are compared
+// by comparing one number.
+//
+// File layout, native byte order, every record has a fixed size so the
+// file can be mapped and walked in place:
+//   header                          magic, version, record count, name bytes, job hash
+//   record[record count]            parents always come before their children
+//   name characters[name bytes]     path::value_type, a record points at its name
+/////////////////////////////////////////////////////////////////////
+
+namespace application{
+    class sync_index{
+    public:
+        // what is known about one entry of the source tree
+        struct entry_record{
+            std::uint64_t size{};
+            std::int64_t mtime{};   // nanoseconds since the epoch of the platform's file times
+            std::uint64_t inode{};  // 0 where the filesystem api does not expose it
+            std::uint64_t hash{};   // content hash of a file, 0 if it was not computed. the digest of a directory's subtree
+            std::filesystem::file_type type{std::filesystem::file_type::none};
+            std::uint32_t mode{};   // permission bits
+
+            // true if nothing but the hash differs, the hash is derived from the rest
+            bool same(const entry_record& other) const noexcept{
+                return size == other.size && mtime == other.mtime && inode == other.inode && type == other.type && mode == other.mode;
+            }
+        };
+
+        // called for every difference found, src is the full source path and relative its path inside the job
+        using change_callback = std::function<void(const std::filesystem::path& src,const std::filesystem::path::string_type& relative,
+                                                   file_queue_status fqs,std::filesystem::file_type type)>;
+
+        // the index of job, stored next to the job's destination as .<destination name>.<job hash>.sfct_index
+        sync_index(const copyto& job) noexcept;
+
+        // reads the index file, false if there is none or it does not belong to the job
+        bool load() noexcept;
+
+        // writes the index file, the old file is only replaced once the new one is complete
+        bool save() noexcept;
+
+        // compares the source tree with the index, calls changed for every difference and updates the index.
+        // directories whose modification time is unchanged are not read, only the entries the index knows are checked.
+        // every_entry is called after each entry so the caller can do other work during a long scan
+        void reconcile(const change_callback& changed,const std::function<void()>& every_entry = {}) noexcept;
+
+        // the entry relative changed, the directory it is in has to be read again by refresh()
+        void touch(const std::filesystem::path::string_type& relative) noexcept;
+
+        // reads the touched directories again, and any directory below them the index is missing or is out of date.
+        // the entries failed() was called for are left out
+        void refresh() noexcept;
+
+        // the entry relative could not be copied. It is left out of the index and the directory it is in is read again
+        // by the next reconcile(), so the entry is queued again after a restart. Until copied() is called for it
+        void failed(const std::filesystem::path::string_type& relative) noexcept;
+
+        // the entry relative was copied, refresh() records it again after failed()
+        void copied(const std::filesystem::path::string_type& relative) noexcept;
+
+        // true if relative is an entry of the source tree the last time its directory was read
+        bool contains(const std::filesystem::path::string_type& relative) const noexcept;
+
+        // the digest of the directory relative and everything below it, 0 if the directory is not in the index.
+        // the digest of "" covers the whole job
+        std::uint64_t digest(const std::filesystem::path::string_type& relative = {}) const noexcept;
+
+        // true if the index changed since it was loaded or saved
+        bool unsaved() const noexcept {return m_unsaved;}
+
+        // true if refresh() has directories to read
+        bool touched() const noexcept {return !m_touched.empty();}
+
+        // the number of entries in the index
+        std::uintmax_t size() const noexcept;
+
+        // true if every entry of the index is in the job's destination. Directories and regular files have to have the same type,
+        // regular files the same size and a modification time that is not older than the source's. Reads the metadata of all of dst
+        bool destination_matches() const noexcept;
+
+        const std::filesystem::path& file() const noexcept {return m_file;}
+    private:
+        // the entries of one directory of the source tree
+        struct directory_record{
+            // the directory itself, when it was read
+            entry_record self;
+            std::unordered_map<std::filesystem::path::string_type,entry_record> entries;
+        };
+
+        copyto m_job;
+        std::filesystem::path m_file;
+        std::uint64_t m_job_hash{};
+
+        // key is the path of the directory relative to the job's source, the source itself is ""
+        std::unordered_map<std::filesystem::path::string_type,directory_record> m_directories;
+
+        // directories refresh() has to read again
+        std::unordered_set<std::filesystem::path::string_type> m_touched;
+
+        // directories whose entries changed, their digests and the digests of the directories above them are out of date
+        std::unordered_set<std::filesystem::path::string_type> m_stale_digests;
+
+        // entries that could not be copied, see failed()
+        std::unordered_set<std::filesystem::path::string_type> m_failed;
+
+        bool m_unsaved{false};
+
+        // the start of the index file
+        struct disk_header{
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t record_count;
+            std::uint64_t name_size;    // in path::value_type characters
+            std::uint64_t job_hash;
+        };
+
+        // one entry of the index file
+        struct disk_record{
+            std::uint64_t size;
+            std::int64_t mtime;
+            std::uint64_t inode;
+            std::uint64_t hash;
+            std::uint64_t name_offset;
+            std::uint32_t name_length;
+            std::uint32_t parent;       // record index of the directory the entry is in, NoParent for the job's source
+            std::uint8_t type;          // std::filesystem::file_type
+            std::uint8_t listed;        // the directory's entries are in the index
+            std::uint8_t reserved[2];
+            std::uint32_t mode;
+        };
+
+        static constexpr char IndexMagic[8] = {'S','F','C','T','I','D','X','1'};
+        static constexpr std::uint32_t IndexVersion = 2;
+        static constexpr std::uint32_t NoParent = UINT32_MAX;
+
+        // brings the directories in start and the ones below them up to date.
+        // deep also checks the entries of directories that are up to date, force reads the start directories even if they are up to date
+        void scan(std::vector<std::filesystem::path::string_type> start,bool deep,bool force,const change_callback& changed,
+                  const std::function<void()>& every_entry) noexcept;
+
+        // drops relative and every directory below it
+        void erase_directories(const std::filesystem::path::string_type& relative) noexcept;
+
+        // removes the failed entries from the directories they are in
+        void drop_failed();
+
+        // computes the digests of the stale directories and the directories above them, deepest first
+        void update_digests();
+
+        std::filesystem::path source_path(const std::filesystem::path::string_type& relative) const;
+
+        static std::filesystem::path::string_type join(const std::filesystem::path::string_type& relative,const std::filesystem::path::string_type& name);
+
+        // the record of p, the type is not_found if it does not exist
+        static entry_record read_record(const std::filesystem::path& p) noexcept;
+    };
+}